@@ -0,0 +1,48 @@
+/// @file Compression.hpp
+/// @author DP-Dev
+/// @brief Functions to compress independent blocks of data.
+#ifndef COMPRESSION_HPP
+#define COMPRESSION_HPP true
+#include <SDL2/SDL.h>
+#include <cstddef>
+
+namespace CPGE
+{
+  /// @brief Get the largest size that a block can take once compressed.
+  /// @param size The size of the data to compress.
+  std::size_t getCompressedBound(std::size_t size);
+  /// @brief Compress a block of data.
+  /// @param source The data to compress.
+  /// @param size The size of the data.
+  /// @param destination The buffer to write the compressed data.
+  /// @param capacity The size of the buffer, at least getCompressedBound().
+  /// @return The size of the compressed data, or zero if the buffer is too
+  /// small.
+  ///
+  /// The format is a sequence of literals and matches in the style of LZ4,
+  /// with matches up to 65535 bytes back. Every block is independent, so it
+  /// can be decompressed without the ones before it.
+  ///
+  /// @sa CPGE::decompressBlock()
+  std::size_t compressBlock(const Uint8 *source, std::size_t size,
+    Uint8 *destination, std::size_t capacity);
+  /// @brief Decompress a block of data.
+  /// @param source The compressed data.
+  /// @param size The size of the compressed data.
+  /// @param destination The buffer to write the data.
+  /// @param rawSize The size of the data before the compression.
+  /// @return true on success, false if the data is damaged.
+  ///
+  /// The compressed data is validated, damaged data never writes out of the
+  /// buffer.
+  ///
+  /// @sa CPGE::compressBlock()
+  bool decompressBlock(const Uint8 *source, std::size_t size,
+    Uint8 *destination, std::size_t rawSize);
+  /// @brief Get the FNV-1a hash of a block of data, to detect damage.
+  /// @param data The data to hash.
+  /// @param size The size of the data.
+  Uint32 getChecksum(const Uint8 *data, std::size_t size);
+} // namespace CPGE
+
+#endif
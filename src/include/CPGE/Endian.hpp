@@ -0,0 +1,43 @@
+/// @file Endian.hpp
+/// @author DP-Dev
+/// @brief Functions to read and write the little endian values of the file
+/// formats.
+#ifndef ENDIAN_HPP
+#define ENDIAN_HPP true
+#include <SDL2/SDL.h>
+#include <vector>
+
+namespace CPGE
+{
+  /// @brief Write a value in little endian order.
+  /// @param bytes The buffer to write, size bytes.
+  /// @param value The value.
+  /// @param size The number of bytes of the value, up to eight.
+  inline void writeLittleEndian(Uint8 *bytes, Uint64 value, unsigned size)
+  {
+    for (unsigned i = 0; i < size; ++i)
+      bytes[i] = static_cast<Uint8>(value >> (i * 8));
+  }
+  /// @brief Append a value in little endian order.
+  /// @param bytes The buffer to append to.
+  /// @param value The value.
+  /// @param size The number of bytes of the value, up to eight.
+  inline void appendLittleEndian(
+    std::vector<Uint8> &bytes, Uint64 value, unsigned size)
+  {
+    for (unsigned i = 0; i < size; ++i)
+      bytes.push_back(static_cast<Uint8>(value >> (i * 8)));
+  }
+  /// @brief Read a value in little endian order.
+  /// @param bytes The buffer to read, size bytes.
+  /// @param size The number of bytes of the value, up to eight.
+  inline Uint64 readLittleEndian(const Uint8 *bytes, unsigned size)
+  {
+    Uint64 value = 0;
+    for (unsigned i = size; i > 0; --i)
+      value = value << 8 | bytes[i - 1];
+    return value;
+  }
+} // namespace CPGE
+
+#endif
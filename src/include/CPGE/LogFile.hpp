@@ -0,0 +1,323 @@
+/// @file LogFile.hpp
+/// @author DP-Dev
+/// @brief Classes to write the log to compressed files and read them back.
+#ifndef LOG_FILE_HPP
+#define LOG_FILE_HPP true
+#include <CPGE/Log.hpp>
+#include <SDL2/SDL.h>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace CPGE
+{
+  /// @brief The text at the start of a log file, before the version.
+  const char LOG_FILE_MAGIC[] = "CPGELOG";
+  /// @brief The version of the log file format.
+  const Uint8 LOG_FILE_VERSION = 2;
+  /// @brief The size of the file header: the magic text and the version.
+  const unsigned LOG_FILE_HEADER_SIZE = 8;
+  /// @brief The size of the records that fill a block before it's written.
+  const unsigned LOG_BLOCK_SIZE = 64 * 1024;
+  /// @brief The size of a record before its text: the ticks, the category,
+  /// the priority and the length of the text.
+  const unsigned LOG_RECORD_HEADER_SIZE = 17;
+  /// @brief The text at the start of an index file, before the version.
+  const char LOG_INDEX_MAGIC[] = "CPGEIDX";
+  /// @brief The version of the index file format.
+  const Uint8 LOG_INDEX_VERSION = 1;
+  /// @brief The size of an entry of an index file: the offset of the block
+  /// and its summary.
+  const unsigned LOG_INDEX_ENTRY_SIZE = 32;
+
+  /// @brief The time range, the categories and the priorities of the
+  /// messages of a block.
+  struct LogBlockSummary
+  {
+    /// @brief The time of the oldest message.
+    Uint64 firstTicks = ~static_cast<Uint64>(0);
+    /// @brief The time of the newest message.
+    Uint64 lastTicks = 0;
+    /// @brief The categories of the messages, bit N is the category N and
+    /// the last bit is shared by the categories from 31 on.
+    Uint32 categories = 0;
+    /// @brief The priorities of the messages, bit N is the priority N.
+    Uint32 priorities = 0;
+    /// @brief Add a message to the summary.
+    /// @param ticks The time of the message.
+    /// @param category The category of the message.
+    /// @param priority The priority of the message.
+    void add(Uint64 ticks, int category, int priority);
+    /// @brief Whether the block can hold messages that match a query.
+    /// @param from The oldest time to match.
+    /// @param to The newest time to match.
+    /// @param categories The categories to match, as a mask.
+    /// @param priorities The priorities to match, as a mask.
+    bool matches(
+      Uint64 from, Uint64 to, Uint32 categories, Uint32 priorities) const;
+    /// @brief Get the bit of a category in the masks.
+    static Uint32 getCategoryBit(int category);
+    /// @brief Get the bit of a priority in the masks.
+    static Uint32 getPriorityBit(int priority);
+  };
+
+  /// @brief The header of a compressed block of records.
+  ///
+  /// Every block is written after its header and can be read without the
+  /// blocks before it, so a file cut by a crash is readable up to its last
+  /// complete block.
+  struct LogBlockHeader
+  {
+    /// @brief The size of the header in the file.
+    static const unsigned SIZE = 40;
+    /// @brief The size of the header in files of version 1, without the
+    /// summary.
+    static const unsigned SIZE_V1 = 16;
+    /// @brief The size of the records.
+    Uint32 rawSize = 0;
+    /// @brief The size of the compressed records, equal to rawSize if they
+    /// are stored without compression.
+    Uint32 compressedSize = 0;
+    /// @brief The checksum of the records.
+    Uint32 checksum = 0;
+    /// @brief The summary of the records.
+    LogBlockSummary summary;
+    /// @brief Write the header in little endian order.
+    /// @param bytes The buffer to write, SIZE bytes.
+    void write(Uint8 *bytes) const;
+    /// @brief Read the header from little endian order.
+    /// @param bytes The buffer to read, getSize() bytes.
+    /// @param version The version of the file.
+    /// @return true on success, false if it isn't a block header.
+    ///
+    /// The headers of version 1 get a summary that matches every query.
+    bool read(const Uint8 *bytes, Uint8 version = LOG_FILE_VERSION);
+    /// @brief Get the size of the header in a version of the format.
+    static unsigned getSize(Uint8 version);
+  };
+
+  /// @brief The position and the summary of a block in a log file.
+  struct LogBlockInfo
+  {
+    /// @brief The offset of the block header in the file.
+    Uint64 offset;
+    /// @brief The summary of the records.
+    LogBlockSummary summary;
+  };
+
+  /// @brief A message read from a log file.
+  struct LogRecord
+  {
+    /// @brief The time of the message, in milliseconds since SDL started.
+    Uint64 ticks;
+    /// @brief The category of the message.
+    LogCategory category;
+    /// @brief The priority of the message.
+    LogPriority priority;
+    /// @brief The text of the message.
+    std::string message;
+  };
+
+  /// @brief The statistics of a log file sink.
+  struct LogFileStats
+  {
+    /// @brief The number of messages received.
+    Uint64 records = 0;
+    /// @brief The number of blocks written.
+    Uint64 blocks = 0;
+    /// @brief The size of the written records.
+    Uint64 rawBytes = 0;
+    /// @brief The size of the written blocks, with their headers.
+    Uint64 compressedBytes = 0;
+  };
+
+  /// @brief A class to write the output of Log to a compressed file.
+  ///
+  /// Messages are appended to a block in memory, a background thread
+  /// compresses the full blocks and writes them. The block with messages is
+  /// also written once per flush interval, so a crash loses at most that
+  /// much of the log. The offset and the summary of every block
+  /// are also written to an index file, the path of the log plus ".idx", so
+  /// queries only read the blocks that can match. Read the files with
+  /// LogFileReader or the tools cpge-logcat and cpge-logquery.
+  class LogFileSink final
+  {
+  public:
+    /// @brief Default constructor.
+    LogFileSink() = default;
+    /// @brief Copy constructor deleted.
+    LogFileSink(const LogFileSink &) = delete;
+    /// @brief Close the file.
+    ~LogFileSink();
+    /// @brief Create a file and send the output of Log to it.
+    /// @param path The path of the file, it and its index are replaced if
+    /// they exist.
+    /// @param forward Whether to pass the messages to the previous output
+    /// function too.
+    /// @return true on success, false otherwise.
+    /// @sa LogFileSink::close()
+    bool open(const std::string &path, bool forward = false);
+    /// @brief Restore the previous output function, write the remaining
+    /// messages and close the file.
+    /// @sa LogFileSink::open()
+    void close();
+    /// @brief Write the messages received so far and wait until they are in
+    /// the file.
+    void flush();
+    /// @brief Set how often the block with messages is written.
+    /// @param interval The interval in milliseconds, zero only writes full
+    /// blocks.
+    /// The default is 1000.
+    void setFlushInterval(Uint32 interval);
+    /// @brief Get the statistics of the sink.
+    LogFileStats getStats();
+    /// @brief Copy operator deleted.
+    const LogFileSink &operator=(const LogFileSink &) = delete;
+
+  private:
+    /// @brief A block of records waiting to be written.
+    struct Block
+    {
+      /// @brief The records.
+      std::vector<Uint8> records;
+      /// @brief The summary of the records.
+      LogBlockSummary summary;
+    };
+    /// @brief The output function given to Log.
+    static void SDLCALL output(void *userdata, int category,
+      SDL_LogPriority priority, const char *message);
+    /// @brief Append a message to the current block.
+    void append(int category, SDL_LogPriority priority, const char *message);
+    /// @brief Queue the current block, the lock must be held.
+    void queueBlock();
+    /// @brief The body of the background thread.
+    void run();
+    /// @brief Compress and write a block and its index entry, from the
+    /// background thread.
+    void writeBlock(const Block &block);
+    /// @brief Protects the blocks and the statistics.
+    std::mutex guard;
+    /// @brief Wakes the background thread.
+    std::condition_variable wakeUp;
+    /// @brief Notifies that a block was written.
+    std::condition_variable written;
+    /// @brief The block that receives the messages.
+    Block block;
+    /// @brief The full blocks waiting for the background thread.
+    std::deque<Block> pending;
+    /// @brief The buffer of the compressed block.
+    std::vector<Uint8> compressed;
+    /// @brief The number of blocks queued.
+    Uint64 queued = 0;
+    /// @brief The statistics.
+    LogFileStats stats;
+    /// @brief The open file, nullptr if there is none.
+    FILE *file = nullptr;
+    /// @brief The index of the open file, nullptr if it can't be written.
+    FILE *index = nullptr;
+    /// @brief The offset of the next block in the file.
+    Uint64 offset = 0;
+    /// @brief Whether a write failed.
+    bool failed = false;
+    /// @brief The output function that was replaced.
+    LogOutputFunction previous = nullptr;
+    /// @brief The user data of the output function that was replaced.
+    void *previousUserdata = nullptr;
+    /// @brief Whether to pass the messages to the previous output function.
+    bool forward = false;
+    /// @brief The milliseconds between two writes of the current block.
+    Uint32 interval = 1000;
+    /// @brief Whether the background thread must stop.
+    bool stopping = false;
+    /// @brief The background thread.
+    std::thread thread;
+  };
+
+  /// @brief Get the name of a category, like "RENDER".
+  /// @param category The category.
+  /// @return The name, or nullptr for the custom categories.
+  const char *getLogCategoryName(LogCategory category);
+  /// @brief Get the name of a priority, like "ERROR".
+  /// @param priority The priority.
+  /// @return The name, or nullptr if it isn't a priority.
+  const char *getLogPriorityName(LogPriority priority);
+  /// @brief Format a message read from a log file as a line of text, with
+  /// the time in seconds, the category and the priority.
+  /// @param record The message.
+  std::string formatLogRecord(const LogRecord &record);
+
+  /// @brief A class to read the messages of a log file.
+  ///
+  /// This class doesn't call SDL, so tools can use it without initializing
+  /// it. Files of version 1, without block summaries, are read too.
+  class LogFileReader final
+  {
+  public:
+    /// @brief Default constructor.
+    LogFileReader() = default;
+    /// @brief Copy constructor deleted.
+    LogFileReader(const LogFileReader &) = delete;
+    /// @brief Close the file.
+    ~LogFileReader();
+    /// @brief Open a log file.
+    /// @param path The path of the file.
+    /// @return true on success, false if it can't be opened or it isn't a
+    /// log file.
+    bool open(const std::string &path);
+    /// @brief Close the file.
+    void close();
+    /// @brief Read the messages of the next block.
+    /// @param records The vector to fill with the messages.
+    /// @return true on success, false at the end of the file or at a block
+    /// that is incomplete or damaged.
+    /// @sa LogFileReader::isTruncated()
+    bool readBlock(std::vector<LogRecord> &records);
+    /// @brief Get the position and the summary of every complete block.
+    /// @param blocks The vector to fill with the blocks.
+    /// @return true on success, false if no file is open.
+    ///
+    /// The blocks come from the index file when there is one. The blocks
+    /// after the last one in the index, or all of them without an index, are
+    /// found walking the block headers, without reading the records.
+    ///
+    /// @sa LogFileReader::seekBlock()
+    bool getBlocks(std::vector<LogBlockInfo> &blocks);
+    /// @brief Move to a block, the next readBlock() reads it.
+    /// @param block The block, from getBlocks().
+    /// @return true on success, false otherwise.
+    bool seekBlock(const LogBlockInfo &block);
+    /// @brief Whether the last getBlocks() used the index file.
+    bool isIndexed() const;
+    /// @brief Whether the reading stopped at an incomplete or damaged block,
+    /// as left by a crash.
+    bool isTruncated() const;
+    /// @brief Copy operator deleted.
+    const LogFileReader &operator=(const LogFileReader &) = delete;
+
+  private:
+    /// @brief Read the index file.
+    void readIndex(std::vector<LogBlockInfo> &blocks, Uint64 size);
+    /// @brief Read the block header at the current position.
+    bool readHeader(LogBlockHeader &header);
+    /// @brief The path of the open file.
+    std::string path;
+    /// @brief The open file, nullptr if there is none.
+    FILE *file = nullptr;
+    /// @brief The version of the open file.
+    Uint8 version = LOG_FILE_VERSION;
+    /// @brief Whether the reading stopped at a bad block.
+    bool truncated = false;
+    /// @brief Whether the last getBlocks() used the index file.
+    bool indexed = false;
+    /// @brief The buffer of the compressed block.
+    std::vector<Uint8> compressed;
+    /// @brief The buffer of the records.
+    std::vector<Uint8> raw;
+  };
+} // namespace CPGE
+
+#endif
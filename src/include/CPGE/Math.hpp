@@ -0,0 +1,596 @@
+/// @file Math.hpp
+/// @author DP-Dev
+/// @brief Vector, matrix and quaternion types.
+///
+/// Every operator on a single value is constexpr, so constants can be
+/// computed at compile time. The batch functions at the end of the file work
+/// on arrays and use SSE, AVX2 or NEON kernels when the library is compiled
+/// with support for them.
+#ifndef MATH_HPP
+#define MATH_HPP true
+#include <cmath>
+#include <cstddef>
+
+namespace CPGE
+{
+  /// @brief A vector of two components.
+  struct Vec2
+  {
+    /// @brief The x component.
+    float x;
+    /// @brief The y component.
+    float y;
+    /// @brief Create a zero vector.
+    constexpr Vec2() : x(0.0f), y(0.0f) {}
+    /// @brief Create a vector from its components.
+    /// @param x The x component.
+    /// @param y The y component.
+    constexpr Vec2(float x, float y) : x(x), y(y) {}
+  };
+
+  /// @brief A vector of three components.
+  struct Vec3
+  {
+    /// @brief The x component.
+    float x;
+    /// @brief The y component.
+    float y;
+    /// @brief The z component.
+    float z;
+    /// @brief Create a zero vector.
+    constexpr Vec3() : x(0.0f), y(0.0f), z(0.0f) {}
+    /// @brief Create a vector from its components.
+    /// @param x The x component.
+    /// @param y The y component.
+    /// @param z The z component.
+    constexpr Vec3(float x, float y, float z) : x(x), y(y), z(z) {}
+  };
+
+  /// @brief A vector of four components, aligned to be loaded in a single
+  /// SIMD register.
+  struct alignas(16) Vec4
+  {
+    /// @brief The x component.
+    float x;
+    /// @brief The y component.
+    float y;
+    /// @brief The z component.
+    float z;
+    /// @brief The w component.
+    float w;
+    /// @brief Create a zero vector.
+    constexpr Vec4() : x(0.0f), y(0.0f), z(0.0f), w(0.0f) {}
+    /// @brief Create a vector from its components.
+    /// @param x The x component.
+    /// @param y The y component.
+    /// @param z The z component.
+    /// @param w The w component.
+    constexpr Vec4(float x, float y, float z, float w)
+      : x(x), y(y), z(z), w(w)
+    {
+    }
+    /// @brief Create a vector from a Vec3 and a w component.
+    /// @param v The x, y and z components.
+    /// @param w The w component.
+    constexpr Vec4(const Vec3 &v, float w) : x(v.x), y(v.y), z(v.z), w(w) {}
+  };
+
+  /// @brief A 3x3 matrix stored in column-major order.
+  struct Mat3
+  {
+    /// @brief The columns of the matrix.
+    Vec3 col[3];
+    /// @brief Create an identity matrix.
+    constexpr Mat3()
+      : col{Vec3(1.0f, 0.0f, 0.0f), Vec3(0.0f, 1.0f, 0.0f),
+          Vec3(0.0f, 0.0f, 1.0f)}
+    {
+    }
+    /// @brief Create a matrix from its columns.
+    /// @param c0 The first column.
+    /// @param c1 The second column.
+    /// @param c2 The third column.
+    constexpr Mat3(const Vec3 &c0, const Vec3 &c1, const Vec3 &c2)
+      : col{c0, c1, c2}
+    {
+    }
+  };
+
+  /// @brief A 4x4 matrix stored in column-major order.
+  struct Mat4
+  {
+    /// @brief The columns of the matrix.
+    Vec4 col[4];
+    /// @brief Create an identity matrix.
+    constexpr Mat4()
+      : col{Vec4(1.0f, 0.0f, 0.0f, 0.0f), Vec4(0.0f, 1.0f, 0.0f, 0.0f),
+          Vec4(0.0f, 0.0f, 1.0f, 0.0f), Vec4(0.0f, 0.0f, 0.0f, 1.0f)}
+    {
+    }
+    /// @brief Create a matrix from its columns.
+    /// @param c0 The first column.
+    /// @param c1 The second column.
+    /// @param c2 The third column.
+    /// @param c3 The fourth column.
+    constexpr Mat4(
+      const Vec4 &c0, const Vec4 &c1, const Vec4 &c2, const Vec4 &c3)
+      : col{c0, c1, c2, c3}
+    {
+    }
+    /// @brief Create a matrix from a 3x3 matrix and a translation.
+    /// @param m The rotation and scale part of the matrix.
+    /// @param t The translation part of the matrix.
+    constexpr Mat4(const Mat3 &m, const Vec3 &t = Vec3())
+      : col{Vec4(m.col[0], 0.0f), Vec4(m.col[1], 0.0f), Vec4(m.col[2], 0.0f),
+          Vec4(t, 1.0f)}
+    {
+    }
+  };
+
+  /// @brief A rotation quaternion.
+  struct alignas(16) Quat
+  {
+    /// @brief The x component of the vector part.
+    float x;
+    /// @brief The y component of the vector part.
+    float y;
+    /// @brief The z component of the vector part.
+    float z;
+    /// @brief The scalar part.
+    float w;
+    /// @brief Create an identity rotation.
+    constexpr Quat() : x(0.0f), y(0.0f), z(0.0f), w(1.0f) {}
+    /// @brief Create a quaternion from its components.
+    /// @param x The x component of the vector part.
+    /// @param y The y component of the vector part.
+    /// @param z The z component of the vector part.
+    /// @param w The scalar part.
+    constexpr Quat(float x, float y, float z, float w)
+      : x(x), y(y), z(z), w(w)
+    {
+    }
+  };
+
+  // Vec2 operations.
+
+  /// @brief Add two vectors.
+  constexpr Vec2 operator+(const Vec2 &a, const Vec2 &b)
+  {
+    return Vec2(a.x + b.x, a.y + b.y);
+  }
+  /// @brief Subtract two vectors.
+  constexpr Vec2 operator-(const Vec2 &a, const Vec2 &b)
+  {
+    return Vec2(a.x - b.x, a.y - b.y);
+  }
+  /// @brief Negate a vector.
+  constexpr Vec2 operator-(const Vec2 &v)
+  {
+    return Vec2(-v.x, -v.y);
+  }
+  /// @brief Multiply two vectors component by component.
+  constexpr Vec2 operator*(const Vec2 &a, const Vec2 &b)
+  {
+    return Vec2(a.x * b.x, a.y * b.y);
+  }
+  /// @brief Scale a vector.
+  constexpr Vec2 operator*(const Vec2 &v, float s)
+  {
+    return Vec2(v.x * s, v.y * s);
+  }
+  /// @brief Scale a vector.
+  constexpr Vec2 operator*(float s, const Vec2 &v)
+  {
+    return Vec2(v.x * s, v.y * s);
+  }
+  /// @brief Divide a vector by a scalar.
+  constexpr Vec2 operator/(const Vec2 &v, float s)
+  {
+    return Vec2(v.x / s, v.y / s);
+  }
+  /// @brief Compare two vectors.
+  constexpr bool operator==(const Vec2 &a, const Vec2 &b)
+  {
+    return a.x == b.x && a.y == b.y;
+  }
+  /// @brief Compare two vectors.
+  constexpr bool operator!=(const Vec2 &a, const Vec2 &b)
+  {
+    return !(a == b);
+  }
+  /// @brief Get the dot product of two vectors.
+  constexpr float dot(const Vec2 &a, const Vec2 &b)
+  {
+    return a.x * b.x + a.y * b.y;
+  }
+  /// @brief Get the z component of the cross product of two vectors.
+  constexpr float cross(const Vec2 &a, const Vec2 &b)
+  {
+    return a.x * b.y - a.y * b.x;
+  }
+  /// @brief Interpolate linearly between two vectors.
+  /// @param a The vector at t = 0.
+  /// @param b The vector at t = 1.
+  /// @param t The interpolation factor.
+  constexpr Vec2 lerp(const Vec2 &a, const Vec2 &b, float t)
+  {
+    return a + (b - a) * t;
+  }
+  /// @brief Get the length of a vector.
+  inline float length(const Vec2 &v)
+  {
+    return std::sqrt(dot(v, v));
+  }
+  /// @brief Get a vector with the same direction and a length of one.
+  inline Vec2 normalize(const Vec2 &v)
+  {
+    return v / length(v);
+  }
+
+  // Vec3 operations.
+
+  /// @brief Add two vectors.
+  constexpr Vec3 operator+(const Vec3 &a, const Vec3 &b)
+  {
+    return Vec3(a.x + b.x, a.y + b.y, a.z + b.z);
+  }
+  /// @brief Subtract two vectors.
+  constexpr Vec3 operator-(const Vec3 &a, const Vec3 &b)
+  {
+    return Vec3(a.x - b.x, a.y - b.y, a.z - b.z);
+  }
+  /// @brief Negate a vector.
+  constexpr Vec3 operator-(const Vec3 &v)
+  {
+    return Vec3(-v.x, -v.y, -v.z);
+  }
+  /// @brief Multiply two vectors component by component.
+  constexpr Vec3 operator*(const Vec3 &a, const Vec3 &b)
+  {
+    return Vec3(a.x * b.x, a.y * b.y, a.z * b.z);
+  }
+  /// @brief Scale a vector.
+  constexpr Vec3 operator*(const Vec3 &v, float s)
+  {
+    return Vec3(v.x * s, v.y * s, v.z * s);
+  }
+  /// @brief Scale a vector.
+  constexpr Vec3 operator*(float s, const Vec3 &v)
+  {
+    return Vec3(v.x * s, v.y * s, v.z * s);
+  }
+  /// @brief Divide a vector by a scalar.
+  constexpr Vec3 operator/(const Vec3 &v, float s)
+  {
+    return Vec3(v.x / s, v.y / s, v.z / s);
+  }
+  /// @brief Compare two vectors.
+  constexpr bool operator==(const Vec3 &a, const Vec3 &b)
+  {
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+  }
+  /// @brief Compare two vectors.
+  constexpr bool operator!=(const Vec3 &a, const Vec3 &b)
+  {
+    return !(a == b);
+  }
+  /// @brief Get the dot product of two vectors.
+  constexpr float dot(const Vec3 &a, const Vec3 &b)
+  {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+  }
+  /// @brief Get the cross product of two vectors.
+  constexpr Vec3 cross(const Vec3 &a, const Vec3 &b)
+  {
+    return Vec3(
+      a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+  }
+  /// @brief Interpolate linearly between two vectors.
+  /// @param a The vector at t = 0.
+  /// @param b The vector at t = 1.
+  /// @param t The interpolation factor.
+  constexpr Vec3 lerp(const Vec3 &a, const Vec3 &b, float t)
+  {
+    return a + (b - a) * t;
+  }
+  /// @brief Get the length of a vector.
+  inline float length(const Vec3 &v)
+  {
+    return std::sqrt(dot(v, v));
+  }
+  /// @brief Get a vector with the same direction and a length of one.
+  inline Vec3 normalize(const Vec3 &v)
+  {
+    return v / length(v);
+  }
+
+  // Vec4 operations.
+
+  /// @brief Add two vectors.
+  constexpr Vec4 operator+(const Vec4 &a, const Vec4 &b)
+  {
+    return Vec4(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w);
+  }
+  /// @brief Subtract two vectors.
+  constexpr Vec4 operator-(const Vec4 &a, const Vec4 &b)
+  {
+    return Vec4(a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w);
+  }
+  /// @brief Negate a vector.
+  constexpr Vec4 operator-(const Vec4 &v)
+  {
+    return Vec4(-v.x, -v.y, -v.z, -v.w);
+  }
+  /// @brief Multiply two vectors component by component.
+  constexpr Vec4 operator*(const Vec4 &a, const Vec4 &b)
+  {
+    return Vec4(a.x * b.x, a.y * b.y, a.z * b.z, a.w * b.w);
+  }
+  /// @brief Scale a vector.
+  constexpr Vec4 operator*(const Vec4 &v, float s)
+  {
+    return Vec4(v.x * s, v.y * s, v.z * s, v.w * s);
+  }
+  /// @brief Scale a vector.
+  constexpr Vec4 operator*(float s, const Vec4 &v)
+  {
+    return Vec4(v.x * s, v.y * s, v.z * s, v.w * s);
+  }
+  /// @brief Divide a vector by a scalar.
+  constexpr Vec4 operator/(const Vec4 &v, float s)
+  {
+    return Vec4(v.x / s, v.y / s, v.z / s, v.w / s);
+  }
+  /// @brief Compare two vectors.
+  constexpr bool operator==(const Vec4 &a, const Vec4 &b)
+  {
+    return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w;
+  }
+  /// @brief Compare two vectors.
+  constexpr bool operator!=(const Vec4 &a, const Vec4 &b)
+  {
+    return !(a == b);
+  }
+  /// @brief Get the dot product of two vectors.
+  constexpr float dot(const Vec4 &a, const Vec4 &b)
+  {
+    return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+  }
+  /// @brief Interpolate linearly between two vectors.
+  /// @param a The vector at t = 0.
+  /// @param b The vector at t = 1.
+  /// @param t The interpolation factor.
+  constexpr Vec4 lerp(const Vec4 &a, const Vec4 &b, float t)
+  {
+    return a + (b - a) * t;
+  }
+  /// @brief Get the length of a vector.
+  inline float length(const Vec4 &v)
+  {
+    return std::sqrt(dot(v, v));
+  }
+  /// @brief Get a vector with the same direction and a length of one.
+  inline Vec4 normalize(const Vec4 &v)
+  {
+    return v / length(v);
+  }
+
+  // Mat3 operations.
+
+  /// @brief Transform a vector.
+  constexpr Vec3 operator*(const Mat3 &m, const Vec3 &v)
+  {
+    return m.col[0] * v.x + m.col[1] * v.y + m.col[2] * v.z;
+  }
+  /// @brief Multiply two matrices.
+  constexpr Mat3 operator*(const Mat3 &a, const Mat3 &b)
+  {
+    return Mat3(a * b.col[0], a * b.col[1], a * b.col[2]);
+  }
+  /// @brief Compare two matrices.
+  constexpr bool operator==(const Mat3 &a, const Mat3 &b)
+  {
+    return a.col[0] == b.col[0] && a.col[1] == b.col[1] &&
+           a.col[2] == b.col[2];
+  }
+  /// @brief Get the transpose of a matrix.
+  constexpr Mat3 transpose(const Mat3 &m)
+  {
+    return Mat3(Vec3(m.col[0].x, m.col[1].x, m.col[2].x),
+      Vec3(m.col[0].y, m.col[1].y, m.col[2].y),
+      Vec3(m.col[0].z, m.col[1].z, m.col[2].z));
+  }
+  /// @brief Get the determinant of a matrix.
+  constexpr float determinant(const Mat3 &m)
+  {
+    return dot(m.col[0], cross(m.col[1], m.col[2]));
+  }
+
+  // Mat4 operations.
+
+  /// @brief Transform a vector.
+  constexpr Vec4 operator*(const Mat4 &m, const Vec4 &v)
+  {
+    return m.col[0] * v.x + m.col[1] * v.y + m.col[2] * v.z + m.col[3] * v.w;
+  }
+  /// @brief Multiply two matrices.
+  constexpr Mat4 operator*(const Mat4 &a, const Mat4 &b)
+  {
+    return Mat4(a * b.col[0], a * b.col[1], a * b.col[2], a * b.col[3]);
+  }
+  /// @brief Compare two matrices.
+  constexpr bool operator==(const Mat4 &a, const Mat4 &b)
+  {
+    return a.col[0] == b.col[0] && a.col[1] == b.col[1] &&
+           a.col[2] == b.col[2] && a.col[3] == b.col[3];
+  }
+  /// @brief Get the transpose of a matrix.
+  constexpr Mat4 transpose(const Mat4 &m)
+  {
+    return Mat4(Vec4(m.col[0].x, m.col[1].x, m.col[2].x, m.col[3].x),
+      Vec4(m.col[0].y, m.col[1].y, m.col[2].y, m.col[3].y),
+      Vec4(m.col[0].z, m.col[1].z, m.col[2].z, m.col[3].z),
+      Vec4(m.col[0].w, m.col[1].w, m.col[2].w, m.col[3].w));
+  }
+  /// @brief Create a translation matrix.
+  constexpr Mat4 translation(const Vec3 &t)
+  {
+    return Mat4(Mat3(), t);
+  }
+  /// @brief Create a scale matrix.
+  constexpr Mat4 scaling(const Vec3 &s)
+  {
+    return Mat4(Vec4(s.x, 0.0f, 0.0f, 0.0f), Vec4(0.0f, s.y, 0.0f, 0.0f),
+      Vec4(0.0f, 0.0f, s.z, 0.0f), Vec4(0.0f, 0.0f, 0.0f, 1.0f));
+  }
+  /// @brief Create an orthographic projection matrix.
+  /// @param left The left plane.
+  /// @param right The right plane.
+  /// @param bottom The bottom plane.
+  /// @param top The top plane.
+  /// @param zNear The near plane.
+  /// @param zFar The far plane.
+  constexpr Mat4 orthographic(
+    float left, float right, float bottom, float top, float zNear, float zFar)
+  {
+    return Mat4(Vec4(2.0f / (right - left), 0.0f, 0.0f, 0.0f),
+      Vec4(0.0f, 2.0f / (top - bottom), 0.0f, 0.0f),
+      Vec4(0.0f, 0.0f, -2.0f / (zFar - zNear), 0.0f),
+      Vec4(-(right + left) / (right - left), -(top + bottom) / (top - bottom),
+        -(zFar + zNear) / (zFar - zNear), 1.0f));
+  }
+  /// @brief Create a perspective projection matrix.
+  /// @param fovy The vertical field of view in radians.
+  /// @param aspect The width divided by the height of the viewport.
+  /// @param zNear The near plane.
+  /// @param zFar The far plane.
+  inline Mat4 perspective(float fovy, float aspect, float zNear, float zFar)
+  {
+    const float f = 1.0f / std::tan(fovy / 2.0f);
+    return Mat4(Vec4(f / aspect, 0.0f, 0.0f, 0.0f), Vec4(0.0f, f, 0.0f, 0.0f),
+      Vec4(0.0f, 0.0f, (zFar + zNear) / (zNear - zFar), -1.0f),
+      Vec4(0.0f, 0.0f, 2.0f * zFar * zNear / (zNear - zFar), 0.0f));
+  }
+
+  // Quaternion operations.
+
+  /// @brief Combine two rotations, b is applied first.
+  constexpr Quat operator*(const Quat &a, const Quat &b)
+  {
+    return Quat(a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+      a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+      a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+      a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z);
+  }
+  /// @brief Compare two quaternions.
+  constexpr bool operator==(const Quat &a, const Quat &b)
+  {
+    return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w;
+  }
+  /// @brief Get the dot product of two quaternions.
+  constexpr float dot(const Quat &a, const Quat &b)
+  {
+    return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+  }
+  /// @brief Get the conjugate of a quaternion, the inverse rotation of an unit
+  /// quaternion.
+  constexpr Quat conjugate(const Quat &q)
+  {
+    return Quat(-q.x, -q.y, -q.z, q.w);
+  }
+  /// @brief Rotate a vector with an unit quaternion.
+  constexpr Vec3 rotate(const Quat &q, const Vec3 &v)
+  {
+    return v + cross(Vec3(q.x, q.y, q.z),
+                 cross(Vec3(q.x, q.y, q.z), v) + v * q.w) *
+                 2.0f;
+  }
+  /// @brief Get the rotation matrix of an unit quaternion.
+  constexpr Mat3 toMat3(const Quat &q)
+  {
+    return Mat3(Vec3(1.0f - 2.0f * (q.y * q.y + q.z * q.z),
+                  2.0f * (q.x * q.y + q.w * q.z),
+                  2.0f * (q.x * q.z - q.w * q.y)),
+      Vec3(2.0f * (q.x * q.y - q.w * q.z),
+        1.0f - 2.0f * (q.x * q.x + q.z * q.z), 2.0f * (q.y * q.z + q.w * q.x)),
+      Vec3(2.0f * (q.x * q.z + q.w * q.y), 2.0f * (q.y * q.z - q.w * q.x),
+        1.0f - 2.0f * (q.x * q.x + q.y * q.y)));
+  }
+  /// @brief Get the rotation matrix of an unit quaternion.
+  constexpr Mat4 toMat4(const Quat &q)
+  {
+    return Mat4(toMat3(q));
+  }
+  /// @brief Create a rotation around an axis.
+  /// @param axis The axis of the rotation, it must have a length of one.
+  /// @param angle The angle in radians.
+  inline Quat fromAxisAngle(const Vec3 &axis, float angle)
+  {
+    const float s = std::sin(angle / 2.0f);
+    return Quat(axis.x * s, axis.y * s, axis.z * s, std::cos(angle / 2.0f));
+  }
+  /// @brief Get a quaternion with the same rotation and a length of one.
+  inline Quat normalize(const Quat &q)
+  {
+    const float l = std::sqrt(dot(q, q));
+    return Quat(q.x / l, q.y / l, q.z / l, q.w / l);
+  }
+  /// @brief Interpolate spherically between two unit quaternions.
+  /// @param a The rotation at t = 0.
+  /// @param b The rotation at t = 1.
+  /// @param t The interpolation factor.
+  Quat slerp(const Quat &a, const Quat &b, float t);
+
+  // Batch operations, vectorized when the library was built with SIMD support.
+
+  /// @brief Transform an array of vectors.
+  /// @param m The transformation matrix.
+  /// @param in The vectors to transform.
+  /// @param out The array to fill with the result, it can be the same as in.
+  /// @param count The number of vectors.
+  void transform(const Mat4 &m, const Vec4 *in, Vec4 *out, std::size_t count);
+  /// @brief Transform an array of points, the w component is taken as one.
+  /// @param m The transformation matrix.
+  /// @param in The points to transform.
+  /// @param out The array to fill with the result, it can be the same as in.
+  /// @param count The number of points.
+  /// @sa transformDirections()
+  void transformPoints(
+    const Mat4 &m, const Vec3 *in, Vec3 *out, std::size_t count);
+  /// @brief Transform an array of directions, the w component is taken as
+  /// zero so the translation is ignored.
+  /// @param m The transformation matrix.
+  /// @param in The directions to transform.
+  /// @param out The array to fill with the result, it can be the same as in.
+  /// @param count The number of directions.
+  /// @sa transformPoints()
+  void transformDirections(
+    const Mat4 &m, const Vec3 *in, Vec3 *out, std::size_t count);
+  /// @brief Rotate an array of vectors with an unit quaternion.
+  /// @param q The rotation.
+  /// @param in The vectors to rotate.
+  /// @param out The array to fill with the result, it can be the same as in.
+  /// @param count The number of vectors.
+  void rotate(const Quat &q, const Vec3 *in, Vec3 *out, std::size_t count);
+  /// @brief Multiply two arrays of matrices element by element.
+  /// @param a The left operands.
+  /// @param b The right operands.
+  /// @param out The array to fill with the result, it can be the same as a or
+  /// b.
+  /// @param count The number of matrices.
+  void multiply(
+    const Mat4 *a, const Mat4 *b, Mat4 *out, std::size_t count);
+  /// @brief Multiply a matrix by an array of matrices, as when converting an
+  /// array of local transforms to world space.
+  /// @param parent The left operand.
+  /// @param in The right operands.
+  /// @param out The array to fill with the result, it can be the same as in.
+  /// @param count The number of matrices.
+  void multiply(
+    const Mat4 &parent, const Mat4 *in, Mat4 *out, std::size_t count);
+  /// @brief Get the name of the instruction set used by the batch operations.
+  /// @return "AVX2", "SSE", "NEON" or "Scalar".
+  const char *mathInstructionSet();
+} // namespace CPGE
+
+#endif
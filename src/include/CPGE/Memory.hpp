@@ -0,0 +1,134 @@
+/// @file Memory.hpp
+/// @author DP-Dev
+/// @brief Classes to attribute heap usage to the engine subsystems.
+#ifndef MEMORY_HPP
+#define MEMORY_HPP true
+#include <SDL2/SDL.h>
+#include <cstddef>
+
+namespace CPGE
+{
+  /// @brief The subsystem that owns an allocation.
+  enum struct MemoryTag
+  {
+    /// @brief Allocations without a more specific tag.
+    GENERAL,
+    /// @brief Allocations of the class Log.
+    LOG,
+    /// @brief Allocations of the class HintsManager.
+    HINTS,
+    /// @brief Allocations made by SDL through SDL_malloc().
+    SDL,
+    /// @brief Allocations of the audio classes.
+    AUDIO,
+    /// @brief Allocations of the rendering classes.
+    RENDER,
+    /// @brief Allocations of the metrics classes.
+    METRICS,
+    /// @brief Allocations of the application.
+    APPLICATION
+  };
+
+  /// @brief The number of memory tags.
+  const unsigned MEMORY_TAGS = 8;
+
+  /// @brief The heap usage of a tag.
+  struct MemoryStats
+  {
+    /// @brief The bytes currently allocated.
+    Sint64 liveBytes;
+    /// @brief The highest value reached by liveBytes.
+    Sint64 peakBytes;
+    /// @brief The number of allocations.
+    Uint64 allocations;
+    /// @brief The number of deallocations.
+    Uint64 frees;
+  };
+
+  /// @brief A class to tag the allocations of the calling thread while it
+  /// exists.
+  ///
+  /// Scopes can be nested, the previous tag is restored when the scope ends.
+  class MemoryTagScope final
+  {
+  public:
+    /// @brief Set the tag of the calling thread.
+    /// @param tag The tag of the new allocations.
+    explicit MemoryTagScope(MemoryTag tag);
+    /// @brief Copy constructor deleted.
+    MemoryTagScope(const MemoryTagScope &) = delete;
+    /// @brief Restore the previous tag.
+    ~MemoryTagScope();
+    /// @brief Copy operator deleted.
+    const MemoryTagScope &operator=(const MemoryTagScope &) = delete;
+
+  private:
+    /// @brief The tag to restore.
+    MemoryTag previous;
+  };
+
+  /// @brief A class to allocate tagged memory and report the heap usage.
+  ///
+  /// Every thread counts its allocations in thread local counters that are
+  /// added to the totals every 64 KiB or 256 operations, so the statistics of
+  /// other threads can be that far behind. When CPGE is built with the CMake
+  /// option CPGE_MEMORY_TRACKING the global operator new and operator delete
+  /// go through this class using the tag of the calling thread.
+  class MemoryTracker final
+  {
+  public:
+    /// @brief Copy constructor deleted.
+    MemoryTracker(const MemoryTracker &) = delete;
+    /// @brief Allocate tagged memory.
+    /// @param size The number of bytes to allocate.
+    /// @param tag The owner of the allocation.
+    /// @return A pointer to the memory, or nullptr if there isn't enough.
+    /// @sa MemoryTracker::deallocate()
+    void *allocate(std::size_t size, MemoryTag tag);
+    /// @brief Allocate memory with the tag of the calling thread.
+    /// @param size The number of bytes to allocate.
+    /// @return A pointer to the memory, or nullptr if there isn't enough.
+    /// @sa MemoryTracker::deallocate()
+    void *allocate(std::size_t size);
+    /// @brief Change the size of tagged memory, keeping its tag.
+    /// @param pointer The memory to resize, or nullptr to allocate.
+    /// @param size The new size, zero frees the memory.
+    /// @return A pointer to the memory, or nullptr if there isn't enough.
+    void *reallocate(void *pointer, std::size_t size);
+    /// @brief Free tagged memory.
+    /// @param pointer The memory to free, it can be nullptr.
+    /// @sa MemoryTracker::allocate()
+    void deallocate(void *pointer);
+    /// @brief Get the tag of the calling thread.
+    MemoryTag getTag() const;
+    /// @brief Get the heap usage of a tag.
+    /// @param tag The tag to query.
+    MemoryStats getStats(MemoryTag tag) const;
+    /// @brief Route the allocations of SDL through this class with
+    /// MemoryTag::SDL.
+    /// @return true on success, false if SDL already allocated memory.
+    ///
+    /// This must be called before any other SDL function.
+    bool hookSDL();
+    /// @brief Print the heap usage and the allocation rate since the last
+    /// report of every tag with LogCategory::SYSTEM.
+    void logReport();
+    /// @brief Copy operator deleted.
+    const MemoryTracker &operator=(const MemoryTracker &) = delete;
+    /// @brief Get the unique instance of the class.
+    static MemoryTracker &getInstace();
+
+  private:
+    /// @brief Private default constructor.
+    MemoryTracker() = default;
+    /// @brief The time of the last report, in milliseconds.
+    Uint64 lastReport = 0;
+    /// @brief The allocations of every tag at the last report.
+    Uint64 lastAllocations[MEMORY_TAGS] = {};
+  };
+
+  /// @brief A reference to the unique instance of the class MemoryTracker.
+  extern MemoryTracker &theMemoryTracker;
+} // namespace CPGE
+
+#endif
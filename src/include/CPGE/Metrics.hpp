@@ -0,0 +1,229 @@
+/// @file Metrics.hpp
+/// @author DP-Dev
+/// @brief Classes to collect counters, gauges and histograms.
+#ifndef METRICS_HPP
+#define METRICS_HPP true
+#include <CPGE/Log.hpp>
+#include <SDL2/SDL.h>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// @brief The milliseconds between two snapshots of the metrics, zero pauses
+/// them. The default is 10000.
+#define CPGE_HINT_METRICS_INTERVAL "CPGE_METRICS_INTERVAL"
+/// @brief The file to append the snapshots to, they are printed with Log if
+/// this isn't set.
+#define CPGE_HINT_METRICS_FILE "CPGE_METRICS_FILE"
+
+namespace CPGE
+{
+  /// @brief The number of shards of every metric owned by a thread.
+  ///
+  /// Each thread owns one shard until it exits and is its only writer, so
+  /// threads don't write the same cache line and an update needs no locked
+  /// instruction. The threads started while every shard is owned share one
+  /// more shard with atomic additions. The shards are summed when the metric
+  /// is read.
+  const unsigned METRICS_SHARDS = 8;
+
+  /// @brief A value that only increases, like the number of frames drawn.
+  class Counter final
+  {
+  public:
+    /// @brief Default constructor.
+    Counter() = default;
+    /// @brief Copy constructor deleted.
+    Counter(const Counter &) = delete;
+    /// @brief Increase the counter.
+    /// @param value The amount to add.
+    void add(Uint64 value = 1);
+    /// @brief Get the value of the counter.
+    Uint64 get() const;
+    /// @brief Copy operator deleted.
+    const Counter &operator=(const Counter &) = delete;
+
+  private:
+    /// @brief A part of the value, padded to fill a cache line.
+    struct Shard
+    {
+      /// @brief The part of the value.
+      std::atomic<Uint64> value{0};
+      /// @brief Padding to keep other shards out of the cache line.
+      char padding[64 - sizeof(std::atomic<Uint64>)];
+    };
+    /// @brief The parts of the value, the last one is shared.
+    Shard shards[METRICS_SHARDS + 1];
+  };
+
+  /// @brief A value that can increase and decrease, like a queue depth.
+  class Gauge final
+  {
+  public:
+    /// @brief Default constructor.
+    Gauge() = default;
+    /// @brief Copy constructor deleted.
+    Gauge(const Gauge &) = delete;
+    /// @brief Set the value of the gauge.
+    /// @param value The new value.
+    void set(Sint64 value);
+    /// @brief Add to the value of the gauge.
+    /// @param value The amount to add, it can be negative.
+    void add(Sint64 value);
+    /// @brief Get the value of the gauge.
+    Sint64 get() const;
+    /// @brief Copy operator deleted.
+    const Gauge &operator=(const Gauge &) = delete;
+
+  private:
+    /// @brief The value of the gauge.
+    std::atomic<Sint64> value{0};
+  };
+
+  /// @brief The aggregated values of a histogram.
+  struct HistogramSnapshot
+  {
+    /// @brief The number of recorded values.
+    Uint64 count = 0;
+    /// @brief The sum of the recorded values.
+    Uint64 sum = 0;
+    /// @brief The number of values in every bucket.
+    std::vector<Uint64> buckets;
+    /// @brief Get a percentile of the recorded values.
+    /// @param percentile The percentile, between 0 and 100.
+    /// @return The highest value of the bucket that holds the percentile, or
+    /// zero if there are no values.
+    Uint64 getPercentile(double percentile) const;
+    /// @brief Get the lowest recorded value, with the bucket precision.
+    Uint64 getMinimum() const;
+    /// @brief Get the highest recorded value, with the bucket precision.
+    Uint64 getMaximum() const;
+  };
+
+  /// @brief A distribution of values, like frame times in nanoseconds.
+  ///
+  /// Values are counted in buckets whose width grows with the value, 16
+  /// buckets per power of two, so every value is known within 6.25% of its
+  /// magnitude.
+  class Histogram final
+  {
+  public:
+    /// @brief The number of buckets.
+    static const unsigned BUCKETS = 976;
+    /// @brief Default constructor.
+    Histogram() = default;
+    /// @brief Copy constructor deleted.
+    Histogram(const Histogram &) = delete;
+    /// @brief Record a value.
+    /// @param value The value to record.
+    void record(Uint64 value);
+    /// @brief Aggregate the recorded values.
+    HistogramSnapshot getSnapshot() const;
+    /// @brief Get the bucket of a value.
+    static unsigned getBucket(Uint64 value);
+    /// @brief Get the highest value of a bucket.
+    static Uint64 getBucketLimit(unsigned bucket);
+    /// @brief Get the lowest value of a bucket.
+    static Uint64 getBucketBase(unsigned bucket);
+    /// @brief Copy operator deleted.
+    const Histogram &operator=(const Histogram &) = delete;
+
+  private:
+    /// @brief A part of the buckets.
+    struct Shard
+    {
+      /// @brief The sum of the values.
+      std::atomic<Uint64> sum{0};
+      /// @brief The number of values in every bucket.
+      std::atomic<Uint64> buckets[BUCKETS];
+      /// @brief Padding to keep other shards out of the last cache line.
+      char padding[64 - sizeof(std::atomic<Uint64>)];
+      /// @brief Set all the buckets to zero.
+      Shard();
+    };
+    /// @brief The parts of the buckets, the last one is shared.
+    Shard shards[METRICS_SHARDS + 1];
+  };
+
+  /// @brief A class to create metrics and write snapshots of them.
+  ///
+  /// The snapshots are written periodically from a background thread. The
+  /// interval and the destination are controlled with the hints
+  /// CPGE_HINT_METRICS_INTERVAL and CPGE_HINT_METRICS_FILE.
+  class MetricsRegistry final
+  {
+  public:
+    /// @brief Copy constructor deleted.
+    MetricsRegistry(const MetricsRegistry &) = delete;
+    /// @brief Stop the snapshots.
+    ~MetricsRegistry();
+    /// @brief Get a counter, creating it if it doesn't exist.
+    /// @param name The name of the counter.
+    /// @return The counter, valid for the lifetime of the registry.
+    Counter &getCounter(const std::string &name);
+    /// @brief Get a gauge, creating it if it doesn't exist.
+    /// @param name The name of the gauge.
+    /// @return The gauge, valid for the lifetime of the registry.
+    Gauge &getGauge(const std::string &name);
+    /// @brief Get a histogram, creating it if it doesn't exist.
+    /// @param name The name of the histogram.
+    /// @return The histogram, valid for the lifetime of the registry.
+    Histogram &getHistogram(const std::string &name);
+    /// @brief Set the category of the snapshots printed with Log.
+    /// @param category The category, LogCategory::SYSTEM by default.
+    void setCategory(const LogCategory &category);
+    /// @brief Write a snapshot of all the metrics now.
+    ///
+    /// Every metric takes a line: "c name value" for counters, "g name value"
+    /// for gauges and "h name count sum min p50 p90 p99 p999 max" for
+    /// histograms, after a line "# ticks" with the time in milliseconds.
+    void writeSnapshot();
+    /// @brief Start writing snapshots from a background thread.
+    /// @sa MetricsRegistry::stopSnapshots()
+    void startSnapshots();
+    /// @brief Stop writing snapshots and wait for the background thread.
+    /// @sa MetricsRegistry::startSnapshots()
+    void stopSnapshots();
+    /// @brief Copy operator deleted.
+    const MetricsRegistry &operator=(const MetricsRegistry &) = delete;
+    /// @brief Get the unique instance of the class.
+    static MetricsRegistry &getInstace();
+
+  private:
+    /// @brief Private default constructor.
+    MetricsRegistry() = default;
+    /// @brief Update the interval when the hint changes.
+    static void SDLCALL intervalChanged(void *userdata, const char *name,
+      const char *oldValue, const char *newValue);
+    /// @brief The body of the background thread.
+    void run();
+    /// @brief Protects the maps and the snapshot state.
+    std::mutex guard;
+    /// @brief Wakes the background thread.
+    std::condition_variable wakeUp;
+    /// @brief The counters by name.
+    std::map<std::string, std::unique_ptr<Counter>> counters;
+    /// @brief The gauges by name.
+    std::map<std::string, std::unique_ptr<Gauge>> gauges;
+    /// @brief The histograms by name.
+    std::map<std::string, std::unique_ptr<Histogram>> histograms;
+    /// @brief The category of the snapshots printed with Log.
+    LogCategory category = LogCategory::SYSTEM;
+    /// @brief The milliseconds between two snapshots.
+    Uint32 interval = 10000;
+    /// @brief Whether the background thread must stop.
+    bool stopping = false;
+    /// @brief The background thread.
+    std::thread thread;
+  };
+
+  /// @brief A reference to the unique instance of the class MetricsRegistry.
+  extern MetricsRegistry &theMetricsRegistry;
+} // namespace CPGE
+
+#endif
@@ -0,0 +1,230 @@
+/// @file Mixer.hpp
+/// @author DP-Dev
+/// @brief Classes to play sounds from the audio callback.
+#ifndef MIXER_HPP
+#define MIXER_HPP true
+#include <CPGE/SPSCQueue.hpp>
+#include <SDL2/SDL.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace CPGE
+{
+  /// @brief A sound decoded to 32 bits float stereo samples.
+  class Sound final
+  {
+  public:
+    /// @brief Default constructor.
+    Sound() = default;
+    /// @brief Load a sound from a WAVE file.
+    /// @param path The path of the file.
+    /// @return true on success, false otherwise.
+    bool loadWAV(const std::string &path);
+    /// @brief Load a sound from interleaved stereo samples.
+    /// @param samples The left and right samples of every frame.
+    /// @param frames The number of frames.
+    /// @param frequency The sample rate of the samples.
+    void load(const float *samples, std::size_t frames, int frequency);
+    /// @brief Get the interleaved stereo samples.
+    const float *getSamples() const;
+    /// @brief Get the number of frames.
+    std::size_t getFrames() const;
+    /// @brief Get the sample rate.
+    int getFrequency() const;
+
+  private:
+    /// @brief The interleaved stereo samples.
+    std::vector<float> samples;
+    /// @brief The sample rate.
+    int frequency = 0;
+  };
+
+  /// @brief An identifier of a playing sound, zero is never a valid voice.
+  typedef Uint32 VoiceID;
+
+  /// @brief The statistics of a mixer.
+  struct MixerStats
+  {
+    /// @brief The number of times the audio callback ran.
+    Uint64 callbacks;
+    /// @brief The number of callbacks that took longer than the duration of
+    /// the buffer they filled, which starves the device.
+    Uint64 underruns;
+    /// @brief The commands lost because the queue was full.
+    Uint64 droppedCommands;
+    /// @brief The sounds not played because all the voices were busy.
+    Uint64 droppedVoices;
+    /// @brief The average time spent in the callback, in seconds.
+    double averageCallbackTime;
+    /// @brief The longest time spent in the callback, in seconds.
+    double maximumCallbackTime;
+    /// @brief The duration of the buffer filled by each callback, in seconds.
+    double bufferDuration;
+    /// @brief The number of voices playing in the last callback.
+    unsigned activeVoices;
+  };
+
+  /// @brief A class to mix sounds inside the SDL audio callback.
+  ///
+  /// The callback never takes a lock: play(), stop() and the volume functions
+  /// send commands through a SPSCQueue, so they must be called from a single
+  /// thread. A Sound must outlive the voices playing it. The mixer works with
+  /// every audio driver, including the dummy driver for headless runs.
+  class Mixer final
+  {
+  public:
+    /// @brief The maximum number of sounds played at the same time.
+    static const unsigned MAX_VOICES = 64;
+    /// @brief Default constructor.
+    Mixer() = default;
+    /// @brief Copy constructor deleted.
+    Mixer(const Mixer &) = delete;
+    /// @brief Close the device if it's open.
+    ~Mixer();
+    /// @brief Open an audio device and start playing.
+    /// @param frequency The desired sample rate.
+    /// @param samples The desired number of frames per callback.
+    /// @param device The name of the device, or nullptr for the default one.
+    /// @return true on success, false otherwise.
+    ///
+    /// The audio subsystem is initialized if it isn't.
+    ///
+    /// @sa Mixer::close()
+    bool open(int frequency = 48000, Uint16 samples = 512,
+      const char *device = nullptr);
+    /// @brief Stop playing and close the device.
+    /// @sa Mixer::open()
+    void close();
+    /// @brief Play a sound.
+    /// @param sound The sound to play.
+    /// @param volume The volume of the sound.
+    /// @param pitch The playback speed, one plays at the original pitch.
+    /// @param loop true to restart the sound when it ends.
+    /// @return The voice that plays the sound, or zero if the command queue
+    /// is full.
+    VoiceID play(const Sound &sound, float volume = 1.0f, float pitch = 1.0f,
+      bool loop = false);
+    /// @brief Stop a voice.
+    /// @param voice The voice to stop.
+    /// @return true if the command was sent, false if the queue is full.
+    bool stop(VoiceID voice);
+    /// @brief Stop all the voices.
+    /// @return true if the command was sent, false if the queue is full.
+    bool stopAll();
+    /// @brief Change the volume of a voice.
+    /// @param voice The voice to change.
+    /// @param volume The new volume.
+    /// @return true if the command was sent, false if the queue is full.
+    bool setVolume(VoiceID voice, float volume);
+    /// @brief Change the volume applied to the mix of all voices.
+    /// @param volume The new volume.
+    /// @return true if the command was sent, false if the queue is full.
+    bool setMasterVolume(float volume);
+    /// @brief Mix the playing voices.
+    /// @param stream The buffer to fill with interleaved stereo samples.
+    /// @param frames The number of frames to fill.
+    ///
+    /// This is called from the audio callback, when no device is open it can
+    /// be called directly to render offline.
+    void mix(float *stream, std::size_t frames);
+    /// @brief Get the statistics of the mixer.
+    MixerStats getStats() const;
+    /// @brief Print the statistics of the mixer with LogCategory::AUDIO.
+    void logStats() const;
+    /// @brief Copy operator deleted.
+    const Mixer &operator=(const Mixer &) = delete;
+
+  private:
+    /// @brief The type of a command.
+    enum struct CommandType
+    {
+      /// @brief Start a voice.
+      PLAY,
+      /// @brief Stop a voice.
+      STOP,
+      /// @brief Stop all the voices.
+      STOP_ALL,
+      /// @brief Change the volume of a voice.
+      VOLUME,
+      /// @brief Change the master volume.
+      MASTER_VOLUME
+    };
+    /// @brief A command for the audio callback.
+    struct Command
+    {
+      /// @brief The type of the command.
+      CommandType type;
+      /// @brief The voice affected by the command.
+      VoiceID voice;
+      /// @brief The sound to play.
+      const Sound *sound;
+      /// @brief The new volume.
+      float volume;
+      /// @brief The playback speed.
+      float pitch;
+      /// @brief Whether the sound loops.
+      bool loop;
+    };
+    /// @brief A playing sound, only used by the audio callback.
+    struct Voice
+    {
+      /// @brief The identifier of the voice, zero if it's free.
+      VoiceID id;
+      /// @brief The interleaved stereo samples.
+      const float *samples;
+      /// @brief The number of frames.
+      std::size_t frames;
+      /// @brief The position in frames, in 32.32 fixed point.
+      Uint64 position;
+      /// @brief The increment of the position per output frame, in 32.32
+      /// fixed point.
+      Uint64 step;
+      /// @brief The volume of the voice.
+      float volume;
+      /// @brief Whether the sound loops.
+      bool loop;
+    };
+    /// @brief The SDL audio callback.
+    static void SDLCALL callback(void *userdata, Uint8 *stream, int length);
+    /// @brief Send a command to the audio callback.
+    bool send(const Command &command);
+    /// @brief Run the pending commands, from the audio callback.
+    void runCommands();
+    /// @brief Add a voice to the mix.
+    /// @return false if the voice ended.
+    bool mixVoice(Voice &voice, float *stream, std::size_t frames);
+    /// @brief The commands for the audio callback.
+    SPSCQueue<Command, 256> commands;
+    /// @brief The voices, only used by the audio callback.
+    Voice voices[MAX_VOICES] = {};
+    /// @brief The volume of the mix, only used by the audio callback.
+    float masterVolume = 1.0f;
+    /// @brief The last voice identifier used.
+    VoiceID lastVoice = 0;
+    /// @brief The open device, zero if there is none.
+    SDL_AudioDeviceID device = 0;
+    /// @brief The sample rate of the mix.
+    std::atomic<int> frequency{48000};
+    /// @brief The number of frames filled per callback.
+    std::atomic<Uint64> bufferFrames{0};
+    /// @brief The number of callbacks.
+    std::atomic<Uint64> callbacks{0};
+    /// @brief The number of callbacks slower than the buffer duration.
+    std::atomic<Uint64> underruns{0};
+    /// @brief The commands lost because the queue was full.
+    std::atomic<Uint64> droppedCommands{0};
+    /// @brief The sounds not played because all the voices were busy.
+    std::atomic<Uint64> droppedVoices{0};
+    /// @brief The total time spent in the callback, in performance counter
+    /// ticks.
+    std::atomic<Uint64> callbackTicks{0};
+    /// @brief The longest time spent in the callback, in performance counter
+    /// ticks.
+    std::atomic<Uint64> maximumCallbackTicks{0};
+    /// @brief The number of voices playing in the last callback.
+    std::atomic<unsigned> activeVoices{0};
+  };
+} // namespace CPGE
+
+#endif
@@ -0,0 +1,155 @@
+/// @file Replay.hpp
+/// @author DP-Dev
+/// @brief Classes to record the input of a session and replay it.
+#ifndef REPLAY_HPP
+#define REPLAY_HPP true
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace CPGE
+{
+  /// @brief A class to record the events and the hints of a session.
+  ///
+  /// The events are captured with an event watch, so they are recorded as
+  /// SDL queues them. Events that hold pointers, like drops and user events,
+  /// can't be replayed and are skipped. Call markFrame() at the start of
+  /// every frame, before polling the events. The events still in the queue
+  /// then, queued after the last poll, are replayed in the frame that polls
+  /// them. Events queued by other threads during markFrame() can move to
+  /// the next frame.
+  class InputRecorder final
+  {
+  public:
+    /// @brief Default constructor.
+    InputRecorder() = default;
+    /// @brief Copy constructor deleted.
+    InputRecorder(const InputRecorder &) = delete;
+    /// @brief Stop the recording.
+    ~InputRecorder();
+    /// @brief Create a file and start recording.
+    /// @param path The path of the file, it's replaced if it exists.
+    /// @param hints The hints to save now and whenever they change.
+    /// @return true on success, false otherwise.
+    /// @sa InputRecorder::stop()
+    bool start(const std::string &path, const std::vector<std::string> &hints);
+    /// @brief Stop recording and close the file.
+    /// @sa InputRecorder::start()
+    void stop();
+    /// @brief Record the start of a frame.
+    void markFrame();
+    /// @brief Get the number of events recorded.
+    Uint64 getEvents();
+    /// @brief Copy operator deleted.
+    const InputRecorder &operator=(const InputRecorder &) = delete;
+
+  private:
+    /// @brief The event watch.
+    static int SDLCALL watch(void *userdata, SDL_Event *event);
+    /// @brief Record the change of a hint.
+    static void SDLCALL hintChanged(void *userdata, const char *name,
+      const char *oldValue, const char *newValue);
+    /// @brief Append a hint to the buffer, the lock must be held.
+    void appendHint(const std::string &name, const std::string &value);
+    /// @brief Write the buffer to the file, the lock must be held.
+    bool writeBuffer();
+    /// @brief Protects the buffer, events can come from any thread.
+    std::mutex guard;
+    /// @brief The data not written yet.
+    std::vector<Uint8> buffer;
+    /// @brief The recorded hints and their last value.
+    std::map<std::string, std::string> hints;
+    /// @brief The open file, nullptr if there is none.
+    FILE *file = nullptr;
+    /// @brief The performance counter when the recording started.
+    Uint64 origin = 0;
+    /// @brief The number of events recorded.
+    Uint64 events = 0;
+    /// @brief The number of events recorded since the last frame marker.
+    Uint32 frameEvents = 0;
+    /// @brief Whether a write failed.
+    bool failed = false;
+  };
+
+  /// @brief A class to replay the events and the hints of a recording.
+  ///
+  /// Call nextFrame() where the recording called InputRecorder::markFrame(),
+  /// it pushes the events of the frame to the SDL queue and measures the
+  /// time of the previous frame. Run the application with the recorded
+  /// frame times from getDeltaTime() so every run does the same work.
+  class InputReplayer final
+  {
+  public:
+    /// @brief Default constructor.
+    InputReplayer() = default;
+    /// @brief Copy constructor deleted.
+    InputReplayer(const InputReplayer &) = delete;
+    /// @brief Open a recording and apply the hints saved at its start.
+    /// @param path The path of the file.
+    /// @return true on success, false if it can't be read or it was recorded
+    /// with an incompatible SDL.
+    bool open(const std::string &path);
+    /// @brief Start the next frame.
+    /// @return true on success, false at the end of the recording.
+    bool nextFrame();
+    /// @brief Get the recorded time of the current frame, in seconds.
+    double getDeltaTime() const;
+    /// @brief Get the number of frames started.
+    Uint64 getFrames() const;
+    /// @brief Get the measured time of every finished frame, in seconds.
+    std::vector<double> getFrameTimes() const;
+    /// @brief Print the minimum, average, percentiles and maximum of the
+    /// frame times with LogCategory::TEST.
+    /// @param perFrame Whether to print the time of every frame too, to find
+    /// the frames of a spike.
+    void logReport(bool perFrame = false);
+    /// @brief Use the dummy video and audio drivers, to replay without a
+    /// window or a sound device.
+    ///
+    /// This must be called before the video and audio subsystems are
+    /// initialized.
+    static void useHeadlessDrivers();
+    /// @brief Copy operator deleted.
+    const InputReplayer &operator=(const InputReplayer &) = delete;
+
+  private:
+    /// @brief Apply the data until the next frame marker.
+    /// @return true on success, false if the data is damaged.
+    bool readFrame();
+    /// @brief Read some bytes of the recording.
+    bool read(void *bytes, std::size_t size);
+    /// @brief Read a hint and apply it.
+    bool readHint();
+    /// @brief Push events to the SDL queue.
+    void pushEvents(const SDL_Event *queue, std::size_t count);
+    /// @brief The recording.
+    std::vector<Uint8> data;
+    /// @brief The version of the recording.
+    Uint8 version = 0;
+    /// @brief The events read until the next frame marker.
+    std::vector<SDL_Event> events;
+    /// @brief The events held back for the next frame, that polls them.
+    std::vector<SDL_Event> held;
+    /// @brief The position of the next byte to read.
+    std::size_t offset = 0;
+    /// @brief Whether there is another frame.
+    bool hasFrame = false;
+    /// @brief The recorded time of the next frame, in microseconds.
+    Uint64 nextTime = 0;
+    /// @brief The recorded time of the current frame, in microseconds.
+    Uint64 time = 0;
+    /// @brief The recorded duration of the current frame, in seconds.
+    double deltaTime = 0.0;
+    /// @brief The number of frames started.
+    Uint64 frames = 0;
+    /// @brief The performance counter at the start of the current frame.
+    Uint64 frameStart = 0;
+    /// @brief The measured duration of every frame, in counter ticks.
+    std::vector<Uint64> frameTimes;
+  };
+} // namespace CPGE
+
+#endif
@@ -0,0 +1,72 @@
+/// @file SPSCQueue.hpp
+/// @author DP-Dev
+/// @brief A wait-free queue for one producer thread and one consumer thread.
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP true
+#include <atomic>
+#include <cstddef>
+
+namespace CPGE
+{
+  /// @brief A bounded queue for one producer thread and one consumer thread.
+  /// @tparam T The type of the items, it must be copy assignable.
+  /// @tparam Capacity The maximum number of items, a power of two.
+  ///
+  /// Neither push() nor pop() block, allocate or take a lock, so the consumer
+  /// can run in a real-time context like the audio callback.
+  template <typename T, std::size_t Capacity> class SPSCQueue final
+  {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+      "The capacity of a SPSCQueue must be a power of two");
+
+  public:
+    /// @brief Default constructor.
+    SPSCQueue() : head(0), tail(0) {}
+    /// @brief Copy constructor deleted.
+    SPSCQueue(const SPSCQueue &) = delete;
+    /// @brief Add an item at the end of the queue, only from the producer.
+    /// @param item The item to add.
+    /// @return true on success, false if the queue is full.
+    bool push(const T &item)
+    {
+      const std::size_t position = tail.load(std::memory_order_relaxed);
+      if (position - head.load(std::memory_order_acquire) == Capacity)
+        return false;
+      items[position & (Capacity - 1)] = item;
+      tail.store(position + 1, std::memory_order_release);
+      return true;
+    }
+    /// @brief Remove the item at the front of the queue, only from the
+    /// consumer.
+    /// @param item The variable to fill with the removed item.
+    /// @return true on success, false if the queue is empty.
+    bool pop(T &item)
+    {
+      const std::size_t position = head.load(std::memory_order_relaxed);
+      if (position == tail.load(std::memory_order_acquire))
+        return false;
+      item = items[position & (Capacity - 1)];
+      head.store(position + 1, std::memory_order_release);
+      return true;
+    }
+    /// @brief Get the number of items in the queue.
+    /// @return The number of items, it can be outdated as soon as it returns.
+    std::size_t size() const
+    {
+      return tail.load(std::memory_order_acquire) -
+             head.load(std::memory_order_acquire);
+    }
+    /// @brief Copy operator deleted.
+    const SPSCQueue &operator=(const SPSCQueue &) = delete;
+
+  private:
+    /// @brief The position of the next item to pop, written by the consumer.
+    alignas(64) std::atomic<std::size_t> head;
+    /// @brief The position of the next item to push, written by the producer.
+    alignas(64) std::atomic<std::size_t> tail;
+    /// @brief The storage of the items.
+    alignas(64) T items[Capacity];
+  };
+} // namespace CPGE
+
+#endif
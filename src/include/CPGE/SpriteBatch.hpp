@@ -0,0 +1,156 @@
+/// @file SpriteBatch.hpp
+/// @author DP-Dev
+/// @brief Classes to draw many sprites with few draw calls.
+#ifndef SPRITE_BATCH_HPP
+#define SPRITE_BATCH_HPP true
+#include <SDL2/SDL.h>
+#include <vector>
+
+namespace CPGE
+{
+  /// @brief The statistics of the last flush of a sprite batch.
+  struct SpriteBatchStats
+  {
+    /// @brief The number of sprites drawn.
+    unsigned long sprites = 0;
+    /// @brief The number of draw calls, or source changes in the software
+    /// path.
+    unsigned long batches = 0;
+    /// @brief The number of destination pixels covered by the sprites.
+    Uint64 pixels = 0;
+    /// @brief The time spent in the flush, in seconds.
+    double seconds = 0.0;
+  };
+
+  /// @brief A class to draw textured sprites through SDL_RenderGeometry().
+  ///
+  /// Sprites are sorted by layer and then by texture, so every run of sprites
+  /// with the same layer and texture is sent in a single draw call. Sprites of
+  /// the same layer and texture keep the order in which they were submitted,
+  /// but sprites of the same layer with different textures may be reordered.
+  class SpriteBatch final
+  {
+  public:
+    /// @brief Default constructor.
+    SpriteBatch() = default;
+    /// @brief Copy constructor deleted.
+    SpriteBatch(const SpriteBatch &) = delete;
+    /// @brief Submit a sprite to draw in the next flush.
+    /// @param texture The texture of the sprite, or nullptr for a solid color.
+    /// @param source The region of the texture to draw.
+    /// @param destination The region of the render target to fill.
+    /// @param layer The layer of the sprite, lower layers are drawn first.
+    /// @param color The color to modulate the texture with.
+    /// @sa SpriteBatch::flush()
+    void draw(SDL_Texture *texture, const SDL_Rect &source,
+      const SDL_FRect &destination, int layer = 0,
+      SDL_Color color = {255, 255, 255, 255});
+    /// @brief Draw all the submitted sprites and clear the batch.
+    /// @param renderer The renderer to draw with.
+    /// @return true on success, false if a draw call failed.
+    /// @sa SpriteBatch::draw()
+    bool flush(SDL_Renderer *renderer);
+    /// @brief Discard the submitted sprites without drawing them.
+    void clear();
+    /// @brief Get the statistics of the last flush.
+    const SpriteBatchStats &getStats() const;
+    /// @brief Print the statistics of the last flush with
+    /// LogCategory::RENDER.
+    void logStats() const;
+    /// @brief Copy operator deleted.
+    const SpriteBatch &operator=(const SpriteBatch &) = delete;
+
+  private:
+    /// @brief A submitted sprite.
+    struct Sprite
+    {
+      /// @brief The texture of the sprite.
+      SDL_Texture *texture;
+      /// @brief The region of the texture.
+      SDL_Rect source;
+      /// @brief The region of the render target.
+      SDL_FRect destination;
+      /// @brief The modulation color.
+      SDL_Color color;
+      /// @brief The layer of the sprite.
+      int layer;
+    };
+    /// @brief The submitted sprites.
+    std::vector<Sprite> sprites;
+    /// @brief The vertices of the current batch, kept to reuse the memory.
+    std::vector<SDL_Vertex> vertices;
+    /// @brief The indices of two triangles per sprite.
+    std::vector<int> indices;
+    /// @brief The statistics of the last flush.
+    SpriteBatchStats stats;
+  };
+
+  /// @brief A class to blend sprites into a surface in software.
+  ///
+  /// Both the sprites and the target must use SDL_PIXELFORMAT_ARGB8888. The
+  /// sprites are scaled with nearest neighbor sampling and alpha blended like
+  /// SDL_BLENDMODE_BLEND, four pixels at a time when SSE2 is available. This
+  /// path needs no renderer, so it works with the dummy video driver.
+  class SoftwareSpriteBatch final
+  {
+  public:
+    /// @brief Default constructor.
+    SoftwareSpriteBatch() = default;
+    /// @brief Copy constructor deleted.
+    SoftwareSpriteBatch(const SoftwareSpriteBatch &) = delete;
+    /// @brief Submit a sprite to draw in the next flush.
+    /// @param surface The pixels of the sprite.
+    /// @param source The region of the surface to draw.
+    /// @param destination The region of the target to fill.
+    /// @param layer The layer of the sprite, lower layers are drawn first.
+    /// @param color The color to modulate the surface with.
+    /// @sa SoftwareSpriteBatch::flush()
+    void draw(SDL_Surface *surface, const SDL_Rect &source,
+      const SDL_Rect &destination, int layer = 0,
+      SDL_Color color = {255, 255, 255, 255});
+    /// @brief Blend all the submitted sprites and clear the batch.
+    /// @param target The surface to draw into, its clip rectangle is honored.
+    /// @return true on success, false if the target or a sprite has an
+    /// unsupported format or can't be locked.
+    /// @sa SoftwareSpriteBatch::draw()
+    bool flush(SDL_Surface *target);
+    /// @brief Discard the submitted sprites without drawing them.
+    void clear();
+    /// @brief Get the statistics of the last flush.
+    const SpriteBatchStats &getStats() const;
+    /// @brief Print the statistics of the last flush with
+    /// LogCategory::RENDER.
+    void logStats() const;
+    /// @brief Copy operator deleted.
+    const SoftwareSpriteBatch &operator=(const SoftwareSpriteBatch &) = delete;
+
+  private:
+    /// @brief A submitted sprite.
+    struct Sprite
+    {
+      /// @brief The surface of the sprite.
+      SDL_Surface *surface;
+      /// @brief The region of the surface.
+      SDL_Rect source;
+      /// @brief The region of the target.
+      SDL_Rect destination;
+      /// @brief The modulation color.
+      SDL_Color color;
+      /// @brief The layer of the sprite.
+      int layer;
+    };
+    /// @brief Blend a sprite into a locked target.
+    /// @param sprite The sprite to blend.
+    /// @param target The target surface.
+    /// @param clip The clip rectangle of the target.
+    /// @return The number of pixels blended.
+    static Uint64 blend(
+      const Sprite &sprite, SDL_Surface *target, const SDL_Rect &clip);
+    /// @brief The submitted sprites.
+    std::vector<Sprite> sprites;
+    /// @brief The statistics of the last flush.
+    SpriteBatchStats stats;
+  };
+} // namespace CPGE
+
+#endif
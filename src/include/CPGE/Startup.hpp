@@ -0,0 +1,194 @@
+/// @file Startup.hpp
+/// @author DP-Dev
+/// @brief A class to initialize the engine services on demand.
+#ifndef STARTUP_HPP
+#define STARTUP_HPP true
+#include <CPGE/LogFile.hpp>
+#include <SDL2/SDL.h>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// @brief The file that the service STARTUP_LOG_FILE writes the log to, the
+/// service does nothing if this isn't set.
+#define CPGE_HINT_LOG_FILE "CPGE_LOG_FILE"
+
+namespace CPGE
+{
+  /// @brief The service that routes the allocations of SDL through
+  /// MemoryTracker, it must be required before any other SDL function.
+  const char STARTUP_MEMORY_HOOK[] = "memory hook";
+  /// @brief The service that writes the log to the file of the hint
+  /// CPGE_HINT_LOG_FILE with a LogFileSink.
+  const char STARTUP_LOG_FILE[] = "log file";
+  /// @brief The service that starts the snapshots of MetricsRegistry, after
+  /// the log file so the snapshots printed with Log are in it.
+  const char STARTUP_METRICS[] = "metrics";
+
+  /// @brief An entry of the startup timeline.
+  struct StartupEvent
+  {
+    /// @brief The name of the service or SDL subsystems initialized.
+    std::string name;
+    /// @brief The time the initialization started, in seconds since the
+    /// static initialization of CPGE.
+    double start;
+    /// @brief The time spent in the initialization, in seconds.
+    double duration;
+    /// @brief Whether the initialization succeeded.
+    bool success;
+    /// @brief Whether the initialization ran in a background thread.
+    bool background;
+  };
+
+  /// @brief A class to initialize SDL subsystems and engine services the
+  /// first time they are needed.
+  ///
+  /// Services are registered with their dependencies and the SDL subsystems
+  /// they use, and initialized by require(), from any thread, in dependency
+  /// order. Every initialization is added to a timeline that shows where the
+  /// time to the first frame goes. The engine services STARTUP_MEMORY_HOOK,
+  /// STARTUP_LOG_FILE and STARTUP_METRICS are registered by the manager.
+  class StartupManager final
+  {
+  public:
+    /// @brief The function that initializes a service, it returns false on
+    /// failure.
+    typedef std::function<bool()> InitFunction;
+    /// @brief The function that shuts a service down.
+    typedef std::function<void()> QuitFunction;
+    /// @brief Copy constructor deleted.
+    StartupManager(const StartupManager &) = delete;
+    /// @brief Wait for the background threads.
+    ~StartupManager();
+    /// @brief Register a service.
+    /// @param name The name of the service.
+    /// @param init The function that initializes the service.
+    /// @param dependencies The services to initialize before this one.
+    /// @param subsystems The SDL_INIT_* flags of the subsystems to initialize
+    /// before this service.
+    /// @param quit The function that shuts the service down, if any.
+    /// @return true on success, false if the name is already registered.
+    bool addService(const std::string &name, InitFunction init,
+      const std::vector<std::string> &dependencies = {}, Uint32 subsystems = 0,
+      QuitFunction quit = nullptr);
+    /// @brief Initialize a service and its dependencies if they aren't.
+    /// @param name The name of the service.
+    /// @return true if the service is initialized, false if it or one of its
+    /// dependencies failed, or if it doesn't exist.
+    ///
+    /// If another thread is initializing the service this waits for it,
+    /// unless that thread is waiting, directly or through other threads, for
+    /// a service this thread is initializing. Such a cycle of dependencies
+    /// fails like a service that depends on itself.
+    /// Some platforms only allow the video and events subsystems in the main
+    /// thread, so other threads leave the services that need them for the
+    /// main thread, returning false.
+    bool require(const std::string &name);
+    /// @brief Initialize SDL subsystems if they aren't.
+    /// @param subsystems The SDL_INIT_* flags of the subsystems.
+    /// @return true on success, false otherwise.
+    bool requireSubsystems(Uint32 subsystems);
+    /// @brief Initialize services in a background thread.
+    /// @param names The services to initialize, in order.
+    ///
+    /// Services that need the video or events subsystems, and the ones that
+    /// depend on them, are initialized by the next require() of the main
+    /// thread.
+    ///
+    /// @sa StartupManager::waitForBackground()
+    void startInBackground(const std::vector<std::string> &names);
+    /// @brief Wait until the background threads finish.
+    /// @sa StartupManager::startInBackground()
+    void waitForBackground();
+    /// @brief Record the time of the first frame, only the first call counts.
+    void markFirstFrame();
+    /// @brief Get the startup timeline.
+    std::vector<StartupEvent> getTimeline();
+    /// @brief Print the startup timeline with LogCategory::SYSTEM.
+    void logTimeline();
+    /// @brief Shut down the initialized services in reverse order and quit
+    /// the SDL subsystems initialized by this class.
+    void shutdown();
+    /// @brief Copy operator deleted.
+    const StartupManager &operator=(const StartupManager &) = delete;
+    /// @brief Get the unique instance of the class.
+    static StartupManager &getInstace();
+
+  private:
+    /// @brief The initialization state of a service.
+    enum struct State
+    {
+      /// @brief Not initialized yet.
+      PENDING,
+      /// @brief Being initialized by a thread.
+      RUNNING,
+      /// @brief Initialized.
+      READY,
+      /// @brief The initialization failed.
+      FAILED
+    };
+    /// @brief A registered service.
+    struct Service
+    {
+      /// @brief The function that initializes the service.
+      InitFunction init;
+      /// @brief The function that shuts the service down.
+      QuitFunction quit;
+      /// @brief The services to initialize before this one.
+      std::vector<std::string> dependencies;
+      /// @brief The SDL subsystems to initialize before this one.
+      Uint32 subsystems;
+      /// @brief The initialization state.
+      State state;
+      /// @brief The thread initializing the service.
+      std::thread::id owner;
+    };
+    /// @brief Private default constructor, register the engine services.
+    StartupManager();
+    /// @brief Whether waiting for a service closes a cycle of threads that
+    /// wait for each other, the lock must be held.
+    bool closesCycle(const Service &service) const;
+    /// @brief Get the seconds elapsed since the manager was created.
+    double now() const;
+    /// @brief Add an entry to the timeline that ends now.
+    void record(const std::string &name, double start, bool success);
+    /// @brief Protects the services and the timeline.
+    std::mutex guard;
+    /// @brief Protects the initialization of SDL subsystems.
+    std::mutex subsystemGuard;
+    /// @brief Notifies the end of an initialization.
+    std::condition_variable finished;
+    /// @brief The services by name.
+    std::map<std::string, Service> services;
+    /// @brief The services initialized, in order.
+    std::vector<std::string> initialized;
+    /// @brief The SDL subsystems initialized by this class.
+    Uint32 subsystems = 0;
+    /// @brief The startup timeline.
+    std::vector<StartupEvent> timeline;
+    /// @brief The service that every thread is waiting for.
+    std::map<std::thread::id, std::string> waiting;
+    /// @brief The background threads.
+    std::vector<std::thread> threads;
+    /// @brief The sink of the service STARTUP_LOG_FILE.
+    LogFileSink logFile;
+    /// @brief The time the manager was created, without SDL that may not be
+    /// hooked yet.
+    std::chrono::steady_clock::time_point origin;
+    /// @brief The thread that created the manager.
+    std::thread::id mainThread;
+    /// @brief Whether the first frame was recorded.
+    bool firstFrame = false;
+  };
+
+  /// @brief A reference to the unique instance of the class StartupManager.
+  extern StartupManager &theStartupManager;
+} // namespace CPGE
+
+#endif
@@ -0,0 +1,192 @@
+// File: Compression.cpp
+// Author: DP-Dev
+// Implementation of the block compression functions.
+#include <CPGE/Compression.hpp>
+#include <algorithm>
+#include <cstring>
+using namespace CPGE;
+using namespace std;
+
+namespace
+{
+  // The shortest match.
+  const size_t MIN_MATCH = 4;
+  // The bytes at the end of a block that are always literals.
+  const size_t LAST_LITERALS = 5;
+  // The bytes at the end of a block where no match starts.
+  const size_t MATCH_LIMIT = 12;
+  // The farthest match.
+  const size_t MAX_OFFSET = 65535;
+  // The size of the hash table, as a power of two.
+  const unsigned HASH_BITS = 12;
+
+  // Read four bytes that can be unaligned.
+  inline Uint32 read32(const Uint8 *data)
+  {
+    Uint32 value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+  }
+
+  // Get the hash table entry of four bytes.
+  inline Uint32 hash(Uint32 value)
+  {
+    return (value * 2654435761u) >> (32 - HASH_BITS);
+  }
+
+  // Write a length that doesn't fit in the token.
+  inline Uint8 *writeLength(Uint8 *output, size_t length)
+  {
+    for (; length >= 255; length -= 255)
+      *output++ = 255;
+    *output++ = static_cast<Uint8>(length);
+    return output;
+  }
+
+  // Read a length that doesn't fit in the token.
+  inline bool readLength(const Uint8 *&input, const Uint8 *end, size_t &length)
+  {
+    Uint8 byte;
+    do
+    {
+      if (input == end)
+        return false;
+      byte = *input++;
+      length += byte;
+    } while (byte == 255);
+    return true;
+  }
+
+  // Write a sequence of literals and a match, no match if the offset is zero.
+  Uint8 *writeSequence(Uint8 *output, const Uint8 *literals, size_t count,
+    size_t offset, size_t length)
+  {
+    Uint8 *token = output++;
+    *token = static_cast<Uint8>((count < 15 ? count : 15) << 4);
+    if (count >= 15)
+      output = writeLength(output, count - 15);
+    memcpy(output, literals, count);
+    output += count;
+    if (!offset)
+      return output;
+    *output++ = static_cast<Uint8>(offset);
+    *output++ = static_cast<Uint8>(offset >> 8);
+    length -= MIN_MATCH;
+    *token |= static_cast<Uint8>(length < 15 ? length : 15);
+    if (length >= 15)
+      output = writeLength(output, length - 15);
+    return output;
+  }
+} // namespace
+
+// Get the largest compressed size.
+size_t CPGE::getCompressedBound(size_t size)
+{
+  return size + size / 255 + 16;
+}
+
+// Compress a block.
+size_t CPGE::compressBlock(
+  const Uint8 *source, size_t size, Uint8 *destination, size_t capacity)
+{
+  // With enough room the output needs no checks.
+  if (capacity < getCompressedBound(size))
+    return 0;
+  Uint32 table[1 << HASH_BITS] = {};
+  const Uint8 *input = source;
+  const Uint8 *anchor = source;
+  Uint8 *output = destination;
+  if (size > MATCH_LIMIT)
+  {
+    const Uint8 *matchEnd = source + size - MATCH_LIMIT;
+    const Uint8 *compareEnd = source + size - LAST_LITERALS;
+    while (input < matchEnd)
+    {
+      const Uint32 value = read32(input);
+      Uint32 &entry = table[hash(value)];
+      const Uint8 *match = source + entry;
+      entry = static_cast<Uint32>(input - source);
+      if (match >= input || static_cast<size_t>(input - match) > MAX_OFFSET ||
+          read32(match) != value)
+      {
+        // Step faster through data that doesn't compress, stopping at the
+        // end of the matches so the pointer stays inside the source.
+        const size_t step = 1 + ((input - anchor) >> 6);
+        input += min(step, static_cast<size_t>(matchEnd - input));
+        continue;
+      }
+      // Extend the match backwards and forwards.
+      while (input > anchor && match > source && input[-1] == match[-1])
+      {
+        --input;
+        --match;
+      }
+      size_t length = MIN_MATCH;
+      while (input + length < compareEnd && input[length] == match[length])
+        ++length;
+      output = writeSequence(output, anchor,
+        static_cast<size_t>(input - anchor),
+        static_cast<size_t>(input - match), length);
+      input += length;
+      anchor = input;
+    }
+  }
+  output = writeSequence(
+    output, anchor, static_cast<size_t>(source + size - anchor), 0, 0);
+  return static_cast<size_t>(output - destination);
+}
+
+// Decompress a block.
+bool CPGE::decompressBlock(
+  const Uint8 *source, size_t size, Uint8 *destination, size_t rawSize)
+{
+  const Uint8 *input = source;
+  const Uint8 *inputEnd = source + size;
+  Uint8 *output = destination;
+  Uint8 *outputEnd = destination + rawSize;
+  while (input < inputEnd)
+  {
+    const Uint8 token = *input++;
+    size_t count = token >> 4;
+    if (count == 15 && !readLength(input, inputEnd, count))
+      return false;
+    if (count > static_cast<size_t>(inputEnd - input) ||
+        count > static_cast<size_t>(outputEnd - output))
+      return false;
+    memcpy(output, input, count);
+    input += count;
+    output += count;
+    // The last sequence has no match.
+    if (input == inputEnd)
+      break;
+    if (inputEnd - input < 2)
+      return false;
+    const size_t offset = input[0] | static_cast<size_t>(input[1]) << 8;
+    input += 2;
+    size_t length = token & 15;
+    if (length == 15 && !readLength(input, inputEnd, length))
+      return false;
+    length += MIN_MATCH;
+    if (!offset || offset > static_cast<size_t>(output - destination) ||
+        length > static_cast<size_t>(outputEnd - output))
+      return false;
+    const Uint8 *match = output - offset;
+    // Overlapping matches repeat the last bytes, they are copied in order.
+    if (offset >= length)
+      memcpy(output, match, length);
+    else
+      for (size_t i = 0; i < length; ++i)
+        output[i] = match[i];
+    output += length;
+  }
+  return output == outputEnd;
+}
+
+// Get the FNV-1a hash of a block.
+Uint32 CPGE::getChecksum(const Uint8 *data, size_t size)
+{
+  Uint32 hash = 2166136261u;
+  for (size_t i = 0; i < size; ++i)
+    hash = (hash ^ data[i]) * 16777619u;
+  return hash;
+}
@@ -2,6 +2,7 @@
 // Author: DP-Dev
 // Implementation of the class Hints.
 #include <CPGE/Hints.hpp>
+#include <CPGE/Memory.hpp>
 using namespace CPGE;
 using namespace std;
 
@@ -25,6 +26,7 @@ void HintsManager::delCallback(
 // Get the value of a hint.
 const string HintsManager::get(const string &name)
 {
+  MemoryTagScope scope(MemoryTag::HINTS);
   const char *hintValue = SDL_GetHint(name.c_str());
   if (!hintValue)
     return "";
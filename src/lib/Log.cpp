@@ -2,6 +2,7 @@
 // Author: DP-Dev
 // Implementation of the log class.
 #include <CPGE/Log.hpp>
+#include <CPGE/Memory.hpp>
 #include <cstdarg>
 using namespace CPGE;
 using namespace std;
@@ -154,6 +155,8 @@ void Log::printMessage(const LogCategory &category, const LogPriority &priority,
 void Log::printMessage(const LogCategory &category, const LogPriority &priority,
   const string fmt, va_list arguments)
 {
+  // Attribute the allocations of the output function to the log.
+  MemoryTagScope scope(MemoryTag::LOG);
   // Pass to SDL_LogMessageV
   SDL_LogMessageV(static_cast<SDL_LogCategory>(category),
     static_cast<SDL_LogPriority>(priority), fmt.c_str(), arguments);
@@ -0,0 +1,273 @@
+// File: LogFile.cpp
+// Author: DP-Dev
+// Implementation of the class LogFileSink.
+#include <CPGE/Compression.hpp>
+#include <CPGE/Endian.hpp>
+#include <CPGE/LogFile.hpp>
+#include <CPGE/Memory.hpp>
+#include <chrono>
+#include <cstring>
+using namespace CPGE;
+using namespace std;
+
+namespace
+{
+  // The full blocks that make the writers wait for the background thread.
+  const size_t MAX_PENDING_BLOCKS = 16;
+
+  // Write the header of a log file or an index file.
+  bool writeFileHeader(FILE *file, const char *magic, Uint8 version)
+  {
+    Uint8 header[LOG_FILE_HEADER_SIZE];
+    memcpy(header, magic, sizeof(header) - 1);
+    header[sizeof(header) - 1] = version;
+    return fwrite(header, 1, sizeof(header), file) == sizeof(header) &&
+           !fflush(file);
+  }
+} // namespace
+
+// Close the file.
+LogFileSink::~LogFileSink()
+{
+  close();
+}
+
+// Create a file and send the output of Log to it.
+bool LogFileSink::open(const string &path, bool forward)
+{
+  close();
+  file = fopen(path.c_str(), "wb");
+  if (!file)
+  {
+    theLog.printError(
+      LogCategory::ERROR, "LogFileSink: can't open %s", path.c_str());
+    return false;
+  }
+  if (!writeFileHeader(file, LOG_FILE_MAGIC, LOG_FILE_VERSION))
+  {
+    theLog.printError(
+      LogCategory::ERROR, "LogFileSink: can't write %s", path.c_str());
+    fclose(file);
+    file = nullptr;
+    return false;
+  }
+  // The log is still written without an index, queries walk the blocks.
+  const string indexPath = path + ".idx";
+  index = fopen(indexPath.c_str(), "wb");
+  if (index && !writeFileHeader(index, LOG_INDEX_MAGIC, LOG_INDEX_VERSION))
+  {
+    fclose(index);
+    index = nullptr;
+  }
+  if (!index)
+  {
+    // The index of a previous log would describe other blocks.
+    remove(indexPath.c_str());
+    theLog.printWarn(LogCategory::ERROR,
+      "LogFileSink: can't write the index of %s", path.c_str());
+  }
+  offset = LOG_FILE_HEADER_SIZE;
+  block = Block();
+  block.records.reserve(LOG_BLOCK_SIZE + LOG_RECORD_HEADER_SIZE);
+  stats = LogFileStats();
+  queued = 0;
+  failed = false;
+  stopping = false;
+  this->forward = forward;
+  thread = std::thread(&LogFileSink::run, this);
+  theLog.getOutputFunction(&previous, &previousUserdata);
+  theLog.setOutputFunction(
+    LogFileSink::output, reinterpret_cast<void **>(this));
+  return true;
+}
+
+// Write the remaining messages and close the file.
+void LogFileSink::close()
+{
+  if (!file)
+    return;
+  theLog.setOutputFunction(
+    previous, reinterpret_cast<void **>(previousUserdata));
+  {
+    lock_guard<std::mutex> lock(guard);
+    queueBlock();
+    stopping = true;
+  }
+  wakeUp.notify_all();
+  thread.join();
+  fclose(file);
+  file = nullptr;
+  if (index)
+    fclose(index);
+  index = nullptr;
+  block = Block();
+  if (failed)
+    theLog.printError(
+      LogCategory::ERROR, "LogFileSink: some blocks couldn't be written");
+}
+
+// Write the messages received so far.
+void LogFileSink::flush()
+{
+  unique_lock<std::mutex> lock(guard);
+  if (!file)
+    return;
+  queueBlock();
+  const Uint64 target = queued;
+  wakeUp.notify_all();
+  written.wait(lock, [this, target]() { return stats.blocks >= target; });
+}
+
+// Set how often the current block is written.
+void LogFileSink::setFlushInterval(Uint32 interval)
+{
+  {
+    lock_guard<std::mutex> lock(guard);
+    this->interval = interval;
+  }
+  wakeUp.notify_all();
+}
+
+// Get the statistics.
+LogFileStats LogFileSink::getStats()
+{
+  lock_guard<std::mutex> lock(guard);
+  return stats;
+}
+
+// Receive a message from Log.
+void SDLCALL LogFileSink::output(
+  void *userdata, int category, SDL_LogPriority priority, const char *message)
+{
+  LogFileSink *sink = static_cast<LogFileSink *>(userdata);
+  sink->append(category, priority, message);
+  if (sink->forward && sink->previous)
+    sink->previous(sink->previousUserdata, category, priority, message);
+}
+
+// Append a message to the current block.
+void LogFileSink::append(
+  int category, SDL_LogPriority priority, const char *message)
+{
+  MemoryTagScope scope(MemoryTag::LOG);
+  const size_t length = strlen(message);
+  const Uint64 ticks = SDL_GetTicks64();
+  unique_lock<std::mutex> lock(guard);
+  // Wait for the background thread when the disk can't keep up, unless the
+  // message comes from it.
+  if (this_thread::get_id() != thread.get_id())
+    written.wait(
+      lock, [this]() { return pending.size() < MAX_PENDING_BLOCKS; });
+  vector<Uint8> &records = block.records;
+  appendLittleEndian(records, ticks, 8);
+  appendLittleEndian(records, static_cast<Uint32>(category), 4);
+  appendLittleEndian(records, static_cast<Uint8>(priority), 1);
+  appendLittleEndian(records, static_cast<Uint32>(length), 4);
+  records.insert(records.end(), message, message + length);
+  block.summary.add(ticks, category, priority);
+  ++stats.records;
+  if (records.size() >= LOG_BLOCK_SIZE)
+  {
+    queueBlock();
+    wakeUp.notify_one();
+  }
+}
+
+// Queue the current block.
+void LogFileSink::queueBlock()
+{
+  if (block.records.empty())
+    return;
+  pending.push_back(Block());
+  pending.back().records.swap(block.records);
+  pending.back().summary = block.summary;
+  block.summary = LogBlockSummary();
+  block.records.reserve(LOG_BLOCK_SIZE + LOG_RECORD_HEADER_SIZE);
+  ++queued;
+}
+
+// Write the blocks until stopped.
+void LogFileSink::run()
+{
+  unique_lock<std::mutex> lock(guard);
+  while (true)
+  {
+    if (pending.empty())
+    {
+      if (stopping)
+        break;
+      // Every interval the block that receives the messages is written as
+      // it is, so a message waits at most that long in memory.
+      if (interval)
+      {
+        if (wakeUp.wait_for(lock, chrono::milliseconds(interval)) ==
+            cv_status::timeout)
+          queueBlock();
+      }
+      else
+        wakeUp.wait(lock);
+      continue;
+    }
+    Block full;
+    full.records.swap(pending.front().records);
+    full.summary = pending.front().summary;
+    pending.pop_front();
+    lock.unlock();
+    writeBlock(full);
+    lock.lock();
+    written.notify_all();
+  }
+}
+
+// Compress and write a block and its index entry.
+void LogFileSink::writeBlock(const Block &block)
+{
+  MemoryTagScope scope(MemoryTag::LOG);
+  const vector<Uint8> &records = block.records;
+  compressed.resize(getCompressedBound(records.size()));
+  LogBlockHeader header;
+  header.rawSize = static_cast<Uint32>(records.size());
+  header.compressedSize = static_cast<Uint32>(compressBlock(
+    records.data(), records.size(), compressed.data(), compressed.size()));
+  header.checksum = getChecksum(records.data(), records.size());
+  header.summary = block.summary;
+  // Blocks that don't compress are stored as they are.
+  const Uint8 *data = compressed.data();
+  if (!header.compressedSize || header.compressedSize >= header.rawSize)
+  {
+    header.compressedSize = header.rawSize;
+    data = records.data();
+  }
+  Uint8 bytes[LogBlockHeader::SIZE];
+  header.write(bytes);
+  const bool success =
+    fwrite(bytes, 1, sizeof(bytes), file) == sizeof(bytes) &&
+    fwrite(data, 1, header.compressedSize, file) == header.compressedSize &&
+    !fflush(file);
+  // The entry goes after the block, an index never points past the log.
+  // After a failed write the offsets are unknown, so the index stops there
+  // and readers walk the block headers that follow it.
+  bool indexed = success && index;
+  if (indexed)
+  {
+    vector<Uint8> entry;
+    appendLittleEndian(entry, offset, 8);
+    appendLittleEndian(entry, block.summary.firstTicks, 8);
+    appendLittleEndian(entry, block.summary.lastTicks, 8);
+    appendLittleEndian(entry, block.summary.categories, 4);
+    appendLittleEndian(entry, block.summary.priorities, 4);
+    indexed = fwrite(entry.data(), 1, entry.size(), index) == entry.size() &&
+              !fflush(index);
+  }
+  if (!indexed && index)
+  {
+    fclose(index);
+    index = nullptr;
+  }
+  offset += sizeof(bytes) + header.compressedSize;
+  lock_guard<std::mutex> lock(guard);
+  ++stats.blocks;
+  stats.rawBytes += header.rawSize;
+  stats.compressedBytes += sizeof(bytes) + header.compressedSize;
+  failed = failed || !success;
+}
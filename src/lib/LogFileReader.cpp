@@ -0,0 +1,348 @@
+// File: LogFileReader.cpp
+// Author: DP-Dev
+// Implementation of the class LogFileReader and the log file format.
+#include <CPGE/Compression.hpp>
+#include <CPGE/Endian.hpp>
+#include <CPGE/LogFile.hpp>
+#include <cstring>
+using namespace CPGE;
+using namespace std;
+
+namespace
+{
+  // The text at the start of a block header, "CPLB" in little endian.
+  const Uint32 BLOCK_MAGIC = 0x424C5043;
+  // The largest block accepted, bigger sizes are damage.
+  const Uint32 MAX_BLOCK_SIZE = 64 * 1024 * 1024;
+
+  // Move to an offset of a file, beyond 2 GiB too.
+  bool seekFile(FILE *file, Uint64 offset, int origin = SEEK_SET)
+  {
+#if defined(_WIN32)
+    return !_fseeki64(file, static_cast<__int64>(offset), origin);
+#else
+    return !fseeko(file, static_cast<off_t>(offset), origin);
+#endif
+  }
+
+  // Get the offset in a file.
+  Uint64 tellFile(FILE *file)
+  {
+#if defined(_WIN32)
+    return static_cast<Uint64>(_ftelli64(file));
+#else
+    return static_cast<Uint64>(ftello(file));
+#endif
+  }
+
+  // The names of the SDL categories.
+  const char *const CATEGORY_NAMES[] = {"APPLICATION", "ERROR", "ASSERT",
+    "SYSTEM", "AUDIO", "VIDEO", "RENDER", "INPUT", "TEST"};
+  // The names of the priorities, starting at LogPriority::VERBOSE.
+  const char *const PRIORITY_NAMES[] = {
+    "VERBOSE", "DEBUG", "INFO", "WARN", "ERROR", "CRITICAL"};
+} // namespace
+
+// Add a message to a block summary.
+void LogBlockSummary::add(Uint64 ticks, int category, int priority)
+{
+  firstTicks = ticks < firstTicks ? ticks : firstTicks;
+  lastTicks = ticks > lastTicks ? ticks : lastTicks;
+  categories |= getCategoryBit(category);
+  priorities |= getPriorityBit(priority);
+}
+
+// Whether a block can hold messages that match a query.
+bool LogBlockSummary::matches(
+  Uint64 from, Uint64 to, Uint32 categories, Uint32 priorities) const
+{
+  return firstTicks <= to && lastTicks >= from &&
+         (this->categories & categories) && (this->priorities & priorities);
+}
+
+// Get the bit of a category.
+Uint32 LogBlockSummary::getCategoryBit(int category)
+{
+  return 1u << (category >= 0 && category < 31 ? category : 31);
+}
+
+// Get the bit of a priority.
+Uint32 LogBlockSummary::getPriorityBit(int priority)
+{
+  return priority >= 0 && priority < 32 ? 1u << priority : 0;
+}
+
+// Write a block header.
+void LogBlockHeader::write(Uint8 *bytes) const
+{
+  writeLittleEndian(bytes, BLOCK_MAGIC, 4);
+  writeLittleEndian(bytes + 4, rawSize, 4);
+  writeLittleEndian(bytes + 8, compressedSize, 4);
+  writeLittleEndian(bytes + 12, checksum, 4);
+  writeLittleEndian(bytes + 16, summary.firstTicks, 8);
+  writeLittleEndian(bytes + 24, summary.lastTicks, 8);
+  writeLittleEndian(bytes + 32, summary.categories, 4);
+  writeLittleEndian(bytes + 36, summary.priorities, 4);
+}
+
+// Read a block header.
+bool LogBlockHeader::read(const Uint8 *bytes, Uint8 version)
+{
+  if (readLittleEndian(bytes, 4) != BLOCK_MAGIC)
+    return false;
+  rawSize = static_cast<Uint32>(readLittleEndian(bytes + 4, 4));
+  compressedSize = static_cast<Uint32>(readLittleEndian(bytes + 8, 4));
+  checksum = static_cast<Uint32>(readLittleEndian(bytes + 12, 4));
+  summary = LogBlockSummary();
+  if (version < 2)
+  {
+    // Without a summary the block can hold anything.
+    summary.firstTicks = 0;
+    summary.lastTicks = ~static_cast<Uint64>(0);
+    summary.categories = ~static_cast<Uint32>(0);
+    summary.priorities = ~static_cast<Uint32>(0);
+  }
+  else
+  {
+    summary.firstTicks = readLittleEndian(bytes + 16, 8);
+    summary.lastTicks = readLittleEndian(bytes + 24, 8);
+    summary.categories = static_cast<Uint32>(readLittleEndian(bytes + 32, 4));
+    summary.priorities = static_cast<Uint32>(readLittleEndian(bytes + 36, 4));
+  }
+  return rawSize <= MAX_BLOCK_SIZE && compressedSize <= MAX_BLOCK_SIZE &&
+         compressedSize <= rawSize;
+}
+
+// Get the size of a block header.
+unsigned LogBlockHeader::getSize(Uint8 version)
+{
+  return version < 2 ? SIZE_V1 : SIZE;
+}
+
+// Get the name of a category.
+const char *CPGE::getLogCategoryName(LogCategory category)
+{
+  const unsigned index = static_cast<unsigned>(category);
+  return index < sizeof(CATEGORY_NAMES) / sizeof(*CATEGORY_NAMES)
+           ? CATEGORY_NAMES[index]
+           : nullptr;
+}
+
+// Get the name of a priority.
+const char *CPGE::getLogPriorityName(LogPriority priority)
+{
+  const unsigned index = static_cast<unsigned>(priority) -
+                         static_cast<unsigned>(LogPriority::VERBOSE);
+  return index < sizeof(PRIORITY_NAMES) / sizeof(*PRIORITY_NAMES)
+           ? PRIORITY_NAMES[index]
+           : nullptr;
+}
+
+// Format a message as a line of text.
+string CPGE::formatLogRecord(const LogRecord &record)
+{
+  char category[16];
+  const char *name = getLogCategoryName(record.category);
+  if (name)
+    snprintf(category, sizeof(category), "%s", name);
+  else
+    snprintf(category, sizeof(category), "%u",
+      static_cast<unsigned>(record.category));
+  const char *priority = getLogPriorityName(record.priority);
+  char prefix[64];
+  snprintf(prefix, sizeof(prefix), "%10llu.%03llu %s %s: ",
+    static_cast<unsigned long long>(record.ticks / 1000),
+    static_cast<unsigned long long>(record.ticks % 1000), category,
+    priority ? priority : "?");
+  return prefix + record.message;
+}
+
+// Close the file.
+LogFileReader::~LogFileReader()
+{
+  close();
+}
+
+// Open a log file.
+bool LogFileReader::open(const string &path)
+{
+  close();
+  file = fopen(path.c_str(), "rb");
+  if (!file)
+    return false;
+  Uint8 header[LOG_FILE_HEADER_SIZE] = {};
+  const bool valid = fread(header, 1, sizeof(header), file) == sizeof(header) &&
+                     !memcmp(header, LOG_FILE_MAGIC, sizeof(header) - 1);
+  version = header[sizeof(header) - 1];
+  if (!valid || version < 1 || version > LOG_FILE_VERSION)
+  {
+    close();
+    return false;
+  }
+  this->path = path;
+  return true;
+}
+
+// Close the file.
+void LogFileReader::close()
+{
+  if (file)
+    fclose(file);
+  file = nullptr;
+  truncated = false;
+  indexed = false;
+}
+
+// Read the messages of the next block.
+bool LogFileReader::readBlock(vector<LogRecord> &records)
+{
+  records.clear();
+  if (!file || truncated)
+    return false;
+  Uint8 bytes[LogBlockHeader::SIZE];
+  const size_t size = LogBlockHeader::getSize(version);
+  const size_t count = fread(bytes, 1, size, file);
+  if (!count)
+    return false;
+  LogBlockHeader header;
+  truncated = true;
+  if (count != size || !header.read(bytes, version))
+    return false;
+  compressed.resize(header.compressedSize);
+  raw.resize(header.rawSize);
+  if (fread(compressed.data(), 1, compressed.size(), file) !=
+      compressed.size())
+    return false;
+  // Blocks that don't compress are stored as they are.
+  if (header.compressedSize == header.rawSize)
+    raw.swap(compressed);
+  else if (!decompressBlock(
+             compressed.data(), compressed.size(), raw.data(), raw.size()))
+    return false;
+  if (getChecksum(raw.data(), raw.size()) != header.checksum)
+    return false;
+  // Split the records.
+  size_t offset = 0;
+  while (offset < raw.size())
+  {
+    if (raw.size() - offset < LOG_RECORD_HEADER_SIZE)
+      return false;
+    const Uint8 *record = raw.data() + offset;
+    const size_t length = static_cast<size_t>(readLittleEndian(record + 13, 4));
+    offset += LOG_RECORD_HEADER_SIZE;
+    if (raw.size() - offset < length)
+      return false;
+    LogRecord message;
+    message.ticks = readLittleEndian(record, 8);
+    message.category = static_cast<LogCategory>(
+      static_cast<int>(readLittleEndian(record + 8, 4)));
+    message.priority = static_cast<LogPriority>(record[12]);
+    message.message.assign(
+      reinterpret_cast<const char *>(raw.data() + offset), length);
+    records.push_back(message);
+    offset += length;
+  }
+  truncated = false;
+  return true;
+}
+
+// Get the position and the summary of every block.
+bool LogFileReader::getBlocks(vector<LogBlockInfo> &blocks)
+{
+  blocks.clear();
+  if (!file)
+    return false;
+  const Uint64 position = tellFile(file);
+  seekFile(file, 0, SEEK_END);
+  const Uint64 size = tellFile(file);
+  const Uint64 headerSize = LogBlockHeader::getSize(version);
+  readIndex(blocks, size);
+  // Walk from the end of the last complete block in the index.
+  Uint64 next = LOG_FILE_HEADER_SIZE;
+  LogBlockHeader header;
+  while (!blocks.empty())
+  {
+    const Uint64 offset = blocks.back().offset;
+    if (seekFile(file, offset) && readHeader(header) &&
+        offset + headerSize + header.compressedSize <= size)
+    {
+      next = offset + headerSize + header.compressedSize;
+      break;
+    }
+    blocks.pop_back();
+  }
+  while (seekFile(file, next) && readHeader(header))
+  {
+    const Uint64 end = next + headerSize + header.compressedSize;
+    if (end > size)
+      break;
+    LogBlockInfo block;
+    block.offset = next;
+    block.summary = header.summary;
+    blocks.push_back(block);
+    next = end;
+  }
+  seekFile(file, position);
+  return true;
+}
+
+// Move to a block.
+bool LogFileReader::seekBlock(const LogBlockInfo &block)
+{
+  truncated = false;
+  return file && seekFile(file, block.offset);
+}
+
+// Whether the last getBlocks() used the index.
+bool LogFileReader::isIndexed() const
+{
+  return indexed;
+}
+
+// Whether the reading stopped at a bad block.
+bool LogFileReader::isTruncated() const
+{
+  return truncated;
+}
+
+// Read the index file.
+void LogFileReader::readIndex(vector<LogBlockInfo> &blocks, Uint64 size)
+{
+  indexed = false;
+  FILE *index = fopen((path + ".idx").c_str(), "rb");
+  if (!index)
+    return;
+  Uint8 bytes[LOG_INDEX_ENTRY_SIZE];
+  if (fread(bytes, 1, LOG_FILE_HEADER_SIZE, index) == LOG_FILE_HEADER_SIZE &&
+      !memcmp(bytes, LOG_INDEX_MAGIC, LOG_FILE_HEADER_SIZE - 1) &&
+      bytes[LOG_FILE_HEADER_SIZE - 1] == LOG_INDEX_VERSION)
+  {
+    indexed = true;
+    // An index cut by a crash is used up to its last entry.
+    Uint64 next = LOG_FILE_HEADER_SIZE;
+    while (fread(bytes, 1, sizeof(bytes), index) == sizeof(bytes))
+    {
+      LogBlockInfo block;
+      block.offset = readLittleEndian(bytes, 8);
+      block.summary.firstTicks = readLittleEndian(bytes + 8, 8);
+      block.summary.lastTicks = readLittleEndian(bytes + 16, 8);
+      block.summary.categories =
+        static_cast<Uint32>(readLittleEndian(bytes + 24, 4));
+      block.summary.priorities =
+        static_cast<Uint32>(readLittleEndian(bytes + 28, 4));
+      if (block.offset < next || block.offset >= size)
+        break;
+      blocks.push_back(block);
+      next = block.offset + 1;
+    }
+  }
+  fclose(index);
+}
+
+// Read the block header at the current position.
+bool LogFileReader::readHeader(LogBlockHeader &header)
+{
+  Uint8 bytes[LogBlockHeader::SIZE];
+  const size_t size = LogBlockHeader::getSize(version);
+  return fread(bytes, 1, size, file) == size && header.read(bytes, version);
+}
@@ -0,0 +1,310 @@
+// File: Math.cpp
+// Author: DP-Dev
+// Implementation of the batch math functions.
+#include "Simd.hpp"
+#include <CPGE/Math.hpp>
+using namespace CPGE;
+using namespace std;
+
+// Check that the constexpr operations can be evaluated at compile time.
+static_assert(translation(Vec3(1.0f, 2.0f, 3.0f)) *
+                  Vec4(1.0f, 1.0f, 1.0f, 1.0f) ==
+                Vec4(2.0f, 3.0f, 4.0f, 1.0f),
+  "Mat4 translation must be constexpr");
+static_assert(scaling(Vec3(2.0f, 2.0f, 2.0f)) * Mat4() ==
+                scaling(Vec3(2.0f, 2.0f, 2.0f)),
+  "Mat4 multiplication must be constexpr");
+static_assert(
+  rotate(Quat(), Vec3(1.0f, 2.0f, 3.0f)) == Vec3(1.0f, 2.0f, 3.0f),
+  "Quaternion rotation must be constexpr");
+static_assert(
+  toMat3(Quat()) == Mat3(), "Quaternion to Mat3 must be constexpr");
+static_assert(
+  sizeof(Vec3) == 12 && sizeof(Vec4) == 16 && sizeof(Mat4) == 64,
+  "SIMD kernels need tightly packed vectors and matrices");
+
+namespace
+{
+  // Transform count vectors with a matrix, the matrix is read before any
+  // vector is written so in and out can overlap with the matrix.
+  void transformKernel(
+    const Mat4 &m, const Vec4 *in, Vec4 *out, size_t count)
+  {
+    size_t i = 0;
+#if defined(CPGE_SIMD_SSE2)
+    // Load the columns of the matrix.
+    const __m128 c0 = _mm_load_ps(&m.col[0].x);
+    const __m128 c1 = _mm_load_ps(&m.col[1].x);
+    const __m128 c2 = _mm_load_ps(&m.col[2].x);
+    const __m128 c3 = _mm_load_ps(&m.col[3].x);
+#if defined(CPGE_SIMD_AVX2)
+    // Duplicate the columns in both halves to transform two vectors per step.
+    const __m256 d0 = _mm256_set_m128(c0, c0);
+    const __m256 d1 = _mm256_set_m128(c1, c1);
+    const __m256 d2 = _mm256_set_m128(c2, c2);
+    const __m256 d3 = _mm256_set_m128(c3, c3);
+    for (; i + 2 <= count; i += 2)
+    {
+      const __m256 v = _mm256_loadu_ps(&in[i].x);
+      __m256 r = _mm256_mul_ps(d0, _mm256_permute_ps(v, 0x00));
+      r = _mm256_add_ps(r, _mm256_mul_ps(d1, _mm256_permute_ps(v, 0x55)));
+      r = _mm256_add_ps(r, _mm256_mul_ps(d2, _mm256_permute_ps(v, 0xAA)));
+      r = _mm256_add_ps(r, _mm256_mul_ps(d3, _mm256_permute_ps(v, 0xFF)));
+      _mm256_storeu_ps(&out[i].x, r);
+    }
+#endif
+    for (; i < count; ++i)
+    {
+      const __m128 v = _mm_load_ps(&in[i].x);
+      __m128 r = _mm_mul_ps(c0, _mm_shuffle_ps(v, v, 0x00));
+      r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_shuffle_ps(v, v, 0x55)));
+      r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_shuffle_ps(v, v, 0xAA)));
+      r = _mm_add_ps(r, _mm_mul_ps(c3, _mm_shuffle_ps(v, v, 0xFF)));
+      _mm_store_ps(&out[i].x, r);
+    }
+#elif defined(CPGE_SIMD_NEON)
+    // Load the columns of the matrix.
+    const float32x4_t c0 = vld1q_f32(&m.col[0].x);
+    const float32x4_t c1 = vld1q_f32(&m.col[1].x);
+    const float32x4_t c2 = vld1q_f32(&m.col[2].x);
+    const float32x4_t c3 = vld1q_f32(&m.col[3].x);
+    for (; i < count; ++i)
+    {
+      const Vec4 v = in[i];
+      float32x4_t r = vmulq_n_f32(c0, v.x);
+      r = vmlaq_n_f32(r, c1, v.y);
+      r = vmlaq_n_f32(r, c2, v.z);
+      r = vmlaq_n_f32(r, c3, v.w);
+      vst1q_f32(&out[i].x, r);
+    }
+#else
+    // Copy the matrix so it can overlap with out.
+    const Mat4 matrix = m;
+    for (; i < count; ++i)
+      out[i] = matrix * in[i];
+#endif
+  }
+
+  // Transform count Vec3 with a matrix and the given w component.
+  void transformKernel(
+    const Mat4 &m, const Vec3 *in, Vec3 *out, size_t count, float w)
+  {
+    // Copy the matrix so it can overlap with out.
+    const Mat4 matrix = m;
+    size_t i = 0;
+#if defined(CPGE_SIMD_SSE2)
+    // Four points per step, kept interleaved: the 12 floats are three
+    // vectors whose lanes cycle through x, y and z, so every output vector is
+    // the input components spread to its lanes times the matrix elements of
+    // its lanes. There is no transpose and no broadcast in the loop.
+    __m128 columns[4][3];
+    for (unsigned c = 0; c < 4; ++c)
+    {
+      const float f = c == 3 ? w : 1.0f;
+      const float e[3] = {
+        matrix.col[c].x * f, matrix.col[c].y * f, matrix.col[c].z * f};
+      // The vector k starts at the component k of a point.
+      for (unsigned k = 0; k < 3; ++k)
+        columns[c][k] =
+          _mm_setr_ps(e[k], e[(k + 1) % 3], e[(k + 2) % 3], e[k]);
+    }
+#if defined(CPGE_SIMD_AVX2)
+    // Duplicate the columns in both halves to transform eight points per step,
+    // four in each half, with the same shuffles as below.
+    __m256 doubled[4][3];
+    for (unsigned c = 0; c < 4; ++c)
+      for (unsigned k = 0; k < 3; ++k)
+        doubled[c][k] = _mm256_set_m128(columns[c][k], columns[c][k]);
+    for (; i + 8 <= count; i += 8)
+    {
+      const float *source = &in[i].x;
+      const __m256 a = _mm256_set_m128(
+        _mm_loadu_ps(source + 12), _mm_loadu_ps(source));
+      const __m256 b = _mm256_set_m128(
+        _mm_loadu_ps(source + 16), _mm_loadu_ps(source + 4));
+      const __m256 c = _mm256_set_m128(
+        _mm_loadu_ps(source + 20), _mm_loadu_ps(source + 8));
+      const __m256 y01 = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1));
+      const __m256 z01 = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2));
+      const __m256 x23 = _mm256_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2));
+      const __m256 y23 = _mm256_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3));
+      __m256 r0 = _mm256_add_ps(doubled[3][0], _mm256_mul_ps(doubled[0][0],
+        _mm256_permute_ps(a, _MM_SHUFFLE(3, 0, 0, 0))));
+      r0 = _mm256_add_ps(r0, _mm256_mul_ps(doubled[1][0],
+        _mm256_permute_ps(y01, _MM_SHUFFLE(2, 0, 0, 0))));
+      r0 = _mm256_add_ps(r0, _mm256_mul_ps(doubled[2][0],
+        _mm256_permute_ps(z01, _MM_SHUFFLE(2, 0, 0, 0))));
+      __m256 r1 = _mm256_add_ps(doubled[3][1], _mm256_mul_ps(doubled[0][1],
+        _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 2, 3, 3))));
+      r1 = _mm256_add_ps(r1, _mm256_mul_ps(doubled[1][1],
+        _mm256_permute_ps(b, _MM_SHUFFLE(3, 3, 0, 0))));
+      r1 = _mm256_add_ps(r1, _mm256_mul_ps(doubled[2][1],
+        _mm256_shuffle_ps(b, c, _MM_SHUFFLE(0, 0, 1, 1))));
+      __m256 r2 = _mm256_add_ps(doubled[3][2], _mm256_mul_ps(doubled[0][2],
+        _mm256_permute_ps(x23, _MM_SHUFFLE(3, 3, 3, 0))));
+      r2 = _mm256_add_ps(r2, _mm256_mul_ps(doubled[1][2],
+        _mm256_permute_ps(y23, _MM_SHUFFLE(3, 3, 3, 0))));
+      r2 = _mm256_add_ps(r2, _mm256_mul_ps(doubled[2][2],
+        _mm256_permute_ps(c, _MM_SHUFFLE(3, 3, 3, 0))));
+      float *destination = &out[i].x;
+      _mm_storeu_ps(destination, _mm256_castps256_ps128(r0));
+      _mm_storeu_ps(destination + 4, _mm256_castps256_ps128(r1));
+      _mm_storeu_ps(destination + 8, _mm256_castps256_ps128(r2));
+      _mm_storeu_ps(destination + 12, _mm256_extractf128_ps(r0, 1));
+      _mm_storeu_ps(destination + 16, _mm256_extractf128_ps(r1, 1));
+      _mm_storeu_ps(destination + 20, _mm256_extractf128_ps(r2, 1));
+    }
+#endif
+    for (; i + 4 <= count; i += 4)
+    {
+      // x0 y0 z0 x1, y1 z1 x2 y2 and z2 x3 y3 z3.
+      const float *source = &in[i].x;
+      const __m128 a = _mm_loadu_ps(source);
+      const __m128 b = _mm_loadu_ps(source + 4);
+      const __m128 c = _mm_loadu_ps(source + 8);
+      // Spread the components to the lanes of every output vector: the
+      // lanes x0 y0 z0 x1 take x0 x0 x0 x1, y0 y0 y0 y1 and z0 z0 z0 z1, the
+      // lanes y1 z1 x2 y2 take x1 x1 x2 x2 and so on.
+      const __m128 y01 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1));
+      const __m128 z01 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2));
+      const __m128 x23 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2));
+      const __m128 y23 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3));
+      __m128 r0 = _mm_add_ps(columns[3][0], _mm_mul_ps(columns[0][0],
+        _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 0, 0))));
+      r0 = _mm_add_ps(r0, _mm_mul_ps(columns[1][0],
+        _mm_shuffle_ps(y01, y01, _MM_SHUFFLE(2, 0, 0, 0))));
+      r0 = _mm_add_ps(r0, _mm_mul_ps(columns[2][0],
+        _mm_shuffle_ps(z01, z01, _MM_SHUFFLE(2, 0, 0, 0))));
+      __m128 r1 = _mm_add_ps(columns[3][1], _mm_mul_ps(columns[0][1],
+        _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 2, 3, 3))));
+      r1 = _mm_add_ps(r1, _mm_mul_ps(columns[1][1],
+        _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 0, 0))));
+      r1 = _mm_add_ps(r1, _mm_mul_ps(columns[2][1],
+        _mm_shuffle_ps(b, c, _MM_SHUFFLE(0, 0, 1, 1))));
+      __m128 r2 = _mm_add_ps(columns[3][2], _mm_mul_ps(columns[0][2],
+        _mm_shuffle_ps(x23, x23, _MM_SHUFFLE(3, 3, 3, 0))));
+      r2 = _mm_add_ps(r2, _mm_mul_ps(columns[1][2],
+        _mm_shuffle_ps(y23, y23, _MM_SHUFFLE(3, 3, 3, 0))));
+      r2 = _mm_add_ps(r2, _mm_mul_ps(columns[2][2],
+        _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 3, 0))));
+      float *destination = &out[i].x;
+      _mm_storeu_ps(destination, r0);
+      _mm_storeu_ps(destination + 4, r1);
+      _mm_storeu_ps(destination + 8, r2);
+    }
+#elif defined(CPGE_SIMD_NEON)
+    // Four points per step, the structured loads and stores transpose them
+    // to one vector of x, one of y and one of z.
+    for (; i + 4 <= count; i += 4)
+    {
+      const float32x4x3_t v = vld3q_f32(&in[i].x);
+      float32x4x3_t r;
+      r.val[0] = vdupq_n_f32(matrix.col[3].x * w);
+      r.val[1] = vdupq_n_f32(matrix.col[3].y * w);
+      r.val[2] = vdupq_n_f32(matrix.col[3].z * w);
+      for (unsigned c = 0; c < 3; ++c)
+      {
+        r.val[0] = vmlaq_n_f32(r.val[0], v.val[c], matrix.col[c].x);
+        r.val[1] = vmlaq_n_f32(r.val[1], v.val[c], matrix.col[c].y);
+        r.val[2] = vmlaq_n_f32(r.val[2], v.val[c], matrix.col[c].z);
+      }
+      vst3q_f32(&out[i].x, r);
+    }
+#endif
+    // The remaining points.
+    for (; i < count; ++i)
+    {
+      const Vec4 r = matrix * Vec4(in[i], w);
+      out[i] = Vec3(r.x, r.y, r.z);
+    }
+  }
+} // namespace
+
+// Interpolate spherically between two rotations.
+Quat CPGE::slerp(const Quat &a, const Quat &b, float t)
+{
+  // Take the shortest path.
+  float cosTheta = dot(a, b);
+  Quat end = b;
+  if (cosTheta < 0.0f)
+  {
+    cosTheta = -cosTheta;
+    end = Quat(-b.x, -b.y, -b.z, -b.w);
+  }
+  // Fall back to a linear interpolation when the rotations are too close.
+  float wa = 1.0f - t;
+  float wb = t;
+  if (cosTheta < 0.9995f)
+  {
+    const float theta = acos(cosTheta);
+    const float sinTheta = sin(theta);
+    wa = sin((1.0f - t) * theta) / sinTheta;
+    wb = sin(t * theta) / sinTheta;
+  }
+  return normalize(Quat(a.x * wa + end.x * wb, a.y * wa + end.y * wb,
+    a.z * wa + end.z * wb, a.w * wa + end.w * wb));
+}
+
+// Transform an array of vectors.
+void CPGE::transform(const Mat4 &m, const Vec4 *in, Vec4 *out, size_t count)
+{
+  transformKernel(m, in, out, count);
+}
+
+// Transform an array of points.
+void CPGE::transformPoints(
+  const Mat4 &m, const Vec3 *in, Vec3 *out, size_t count)
+{
+  transformKernel(m, in, out, count, 1.0f);
+}
+
+// Transform an array of directions.
+void CPGE::transformDirections(
+  const Mat4 &m, const Vec3 *in, Vec3 *out, size_t count)
+{
+  transformKernel(m, in, out, count, 0.0f);
+}
+
+// Rotate an array of vectors.
+void CPGE::rotate(const Quat &q, const Vec3 *in, Vec3 *out, size_t count)
+{
+  // A matrix is cheaper than the quaternion formula once per vector.
+  transformKernel(toMat4(q), in, out, count, 0.0f);
+}
+
+// Multiply two arrays of matrices.
+void CPGE::multiply(const Mat4 *a, const Mat4 *b, Mat4 *out, size_t count)
+{
+  // Every column of the result is the left matrix applied to the column of
+  // the right one.
+  for (size_t i = 0; i < count; ++i)
+  {
+    const Mat4 right = b[i];
+    transformKernel(a[i], right.col, out[i].col, 4);
+  }
+}
+
+// Multiply a matrix by an array of matrices.
+void CPGE::multiply(
+  const Mat4 &parent, const Mat4 *in, Mat4 *out, size_t count)
+{
+  if (count == 0)
+    return;
+  // The columns of all the matrices are contiguous.
+  const Mat4 left = parent;
+  transformKernel(left, in[0].col, out[0].col, count * 4);
+}
+
+// Get the instruction set used by the batch functions.
+const char *CPGE::mathInstructionSet()
+{
+#if defined(CPGE_SIMD_AVX2)
+  return "AVX2";
+#elif defined(CPGE_SIMD_SSE2)
+  return "SSE";
+#elif defined(CPGE_SIMD_NEON)
+  return "NEON";
+#else
+  return "Scalar";
+#endif
+}
@@ -0,0 +1,127 @@
+// File: Memory.cpp
+// Author: DP-Dev
+// Implementation of the memory tracking classes.
+#include "MemoryAllocator.hpp"
+#include <CPGE/Log.hpp>
+#include <cstring>
+using namespace CPGE;
+using namespace std;
+
+// Set the reference to the unique instance of the class.
+MemoryTracker &CPGE::theMemoryTracker = MemoryTracker::getInstace();
+
+namespace
+{
+  // The names of the tags.
+  const char *const TAG_NAMES[MEMORY_TAGS] = {"GENERAL", "LOG", "HINTS", "SDL",
+    "AUDIO", "RENDER", "METRICS", "APPLICATION"};
+
+  // The functions given to SDL_SetMemoryFunctions().
+  void *SDLCALL sdlMalloc(size_t size)
+  {
+    return allocateTagged(size, static_cast<unsigned>(MemoryTag::SDL));
+  }
+  void *SDLCALL sdlCalloc(size_t count, size_t size)
+  {
+    if (size && count > static_cast<size_t>(-1) / size)
+      return nullptr;
+    void *pointer =
+      allocateTagged(count * size, static_cast<unsigned>(MemoryTag::SDL));
+    if (pointer)
+      memset(pointer, 0, count * size);
+    return pointer;
+  }
+  void *SDLCALL sdlRealloc(void *pointer, size_t size)
+  {
+    return reallocateTagged(
+      pointer, size, static_cast<unsigned>(MemoryTag::SDL));
+  }
+  void SDLCALL sdlFree(void *pointer)
+  {
+    deallocateTagged(pointer);
+  }
+} // namespace
+
+// Allocate tagged memory.
+void *MemoryTracker::allocate(size_t size, MemoryTag tag)
+{
+  return allocateTagged(size, static_cast<unsigned>(tag));
+}
+
+// Allocate memory with the tag of the thread.
+void *MemoryTracker::allocate(size_t size)
+{
+  return allocateTagged(size, static_cast<unsigned>(getThreadTag()));
+}
+
+// Resize tagged memory.
+void *MemoryTracker::reallocate(void *pointer, size_t size)
+{
+  return reallocateTagged(pointer, size, static_cast<unsigned>(getThreadTag()));
+}
+
+// Free tagged memory.
+void MemoryTracker::deallocate(void *pointer)
+{
+  deallocateTagged(pointer);
+}
+
+// Get the tag of the thread.
+MemoryTag MemoryTracker::getTag() const
+{
+  return getThreadTag();
+}
+
+// Get the heap usage of a tag.
+MemoryStats MemoryTracker::getStats(MemoryTag tag) const
+{
+  // Make the counters of the calling thread visible.
+  return getTaggedStats(static_cast<unsigned>(tag));
+}
+
+// Route the allocations of SDL through the tracker.
+bool MemoryTracker::hookSDL()
+{
+  // Memory allocated before the hook has no header.
+  if (SDL_GetNumAllocations())
+  {
+    theLog.printError(LogCategory::SYSTEM,
+      "MemoryTracker: SDL allocated memory before the hook");
+    return false;
+  }
+  return !SDL_SetMemoryFunctions(sdlMalloc, sdlCalloc, sdlRealloc, sdlFree);
+}
+
+// Print the heap usage of every tag.
+void MemoryTracker::logReport()
+{
+  const Uint64 now = SDL_GetTicks64();
+  const double seconds = static_cast<double>(now - lastReport) / 1000.0;
+  for (unsigned tag = 0; tag < MEMORY_TAGS; ++tag)
+  {
+    const MemoryStats stats = getStats(static_cast<MemoryTag>(tag));
+    if (!stats.allocations)
+      continue;
+    const double rate =
+      seconds > 0.0
+        ? static_cast<double>(stats.allocations - lastAllocations[tag]) /
+            seconds
+        : 0.0;
+    theLog.printInfo(LogCategory::SYSTEM,
+      "Memory %s: %lld KiB live, %lld KiB peak, %llu allocations (%.0f/s), "
+      "%llu frees",
+      TAG_NAMES[tag], static_cast<long long>(stats.liveBytes / 1024),
+      static_cast<long long>(stats.peakBytes / 1024),
+      static_cast<unsigned long long>(stats.allocations), rate,
+      static_cast<unsigned long long>(stats.frees));
+    lastAllocations[tag] = stats.allocations;
+  }
+  lastReport = now;
+}
+
+// Get the unique instance of the class.
+MemoryTracker &MemoryTracker::getInstace()
+{
+  static MemoryTracker theMemoryTracker;
+  return theMemoryTracker;
+}
@@ -0,0 +1,226 @@
+// File: MemoryAllocator.cpp
+// Author: DP-Dev
+// Implementation of the tagged allocator and the global operator new. It
+// doesn't call SDL, so the tools that only get operator new from the library
+// link without it.
+#include "MemoryAllocator.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+using namespace CPGE;
+using namespace std;
+
+namespace
+{
+  // The pending bytes that make a thread add its counters to the totals.
+  const Sint64 FLUSH_BYTES = 64 * 1024;
+  // The pending operations that make a thread add its counters to the totals.
+  const Uint64 FLUSH_OPERATIONS = 256;
+
+  // The header stored before every allocation, it keeps the alignment of
+  // malloc().
+  struct alignas(alignof(max_align_t)) Header
+  {
+    // The size requested.
+    size_t size;
+    // The tag of the allocation.
+    unsigned tag;
+  };
+
+  // The totals of a tag. Static storage is zeroed before any constructor
+  // runs, so allocations made during static initialization are counted.
+  struct TagCounters
+  {
+    // The bytes currently allocated.
+    atomic<Sint64> liveBytes;
+    // The highest value reached by liveBytes.
+    atomic<Sint64> peakBytes;
+    // The number of allocations.
+    atomic<Uint64> allocations;
+    // The number of deallocations.
+    atomic<Uint64> frees;
+  };
+  TagCounters totals[MEMORY_TAGS];
+
+  // The counters of a thread that aren't in the totals yet.
+  struct ThreadCounters
+  {
+    // The change of the allocated bytes.
+    Sint64 bytes[MEMORY_TAGS];
+    // The number of allocations.
+    Uint64 allocations[MEMORY_TAGS];
+    // The number of deallocations.
+    Uint64 frees[MEMORY_TAGS];
+    // Add the counters of a tag to the totals.
+    void flush(unsigned tag)
+    {
+      TagCounters &total = totals[tag];
+      const Sint64 live =
+        total.liveBytes.fetch_add(bytes[tag], memory_order_relaxed) +
+        bytes[tag];
+      Sint64 peak = total.peakBytes.load(memory_order_relaxed);
+      while (live > peak && !total.peakBytes.compare_exchange_weak(
+                              peak, live, memory_order_relaxed))
+        ;
+      total.allocations.fetch_add(allocations[tag], memory_order_relaxed);
+      total.frees.fetch_add(frees[tag], memory_order_relaxed);
+      bytes[tag] = 0;
+      allocations[tag] = 0;
+      frees[tag] = 0;
+    }
+    // Add the remaining counters when the thread ends.
+    ~ThreadCounters()
+    {
+      for (unsigned tag = 0; tag < MEMORY_TAGS; ++tag)
+        flush(tag);
+    }
+  };
+  thread_local ThreadCounters threadCounters;
+
+  // The tag of the calling thread.
+  thread_local MemoryTag threadTag = MemoryTag::GENERAL;
+} // namespace
+
+// Allocate memory with a header.
+void *CPGE::allocateTagged(size_t size, unsigned tag)
+{
+  // The header must not wrap the size around.
+  if (size > static_cast<size_t>(-1) - sizeof(Header))
+    return nullptr;
+  Header *header = static_cast<Header *>(malloc(sizeof(Header) + size));
+  if (!header)
+    return nullptr;
+  header->size = size;
+  header->tag = tag;
+  ThreadCounters &counters = threadCounters;
+  counters.bytes[tag] += static_cast<Sint64>(size);
+  ++counters.allocations[tag];
+  if (counters.bytes[tag] >= FLUSH_BYTES ||
+      counters.allocations[tag] >= FLUSH_OPERATIONS)
+    counters.flush(tag);
+  return header + 1;
+}
+
+// Free memory with a header.
+void CPGE::deallocateTagged(void *pointer)
+{
+  if (!pointer)
+    return;
+  Header *header = static_cast<Header *>(pointer) - 1;
+  const unsigned tag = header->tag;
+  ThreadCounters &counters = threadCounters;
+  counters.bytes[tag] -= static_cast<Sint64>(header->size);
+  ++counters.frees[tag];
+  if (counters.bytes[tag] <= -FLUSH_BYTES ||
+      counters.frees[tag] >= FLUSH_OPERATIONS)
+    counters.flush(tag);
+  free(header);
+}
+
+// Resize memory with a header, keeping its tag.
+void *CPGE::reallocateTagged(void *pointer, size_t size, unsigned tag)
+{
+  if (!pointer)
+    return allocateTagged(size, tag);
+  if (!size)
+  {
+    deallocateTagged(pointer);
+    return nullptr;
+  }
+  if (size > static_cast<size_t>(-1) - sizeof(Header))
+    return nullptr;
+  Header *header = static_cast<Header *>(pointer) - 1;
+  const Sint64 previous = static_cast<Sint64>(header->size);
+  tag = header->tag;
+  header = static_cast<Header *>(realloc(header, sizeof(Header) + size));
+  if (!header)
+    return nullptr;
+  header->size = size;
+  ThreadCounters &counters = threadCounters;
+  counters.bytes[tag] += static_cast<Sint64>(size) - previous;
+  if (counters.bytes[tag] >= FLUSH_BYTES ||
+      counters.bytes[tag] <= -FLUSH_BYTES)
+    counters.flush(tag);
+  return header + 1;
+}
+
+// Flush the counters of the calling thread and get the totals of a tag.
+MemoryStats CPGE::getTaggedStats(unsigned tag)
+{
+  threadCounters.flush(tag);
+  const TagCounters &total = totals[tag];
+  MemoryStats stats;
+  stats.liveBytes = total.liveBytes.load(memory_order_relaxed);
+  stats.peakBytes = total.peakBytes.load(memory_order_relaxed);
+  stats.allocations = total.allocations.load(memory_order_relaxed);
+  stats.frees = total.frees.load(memory_order_relaxed);
+  return stats;
+}
+
+// Get the tag of the calling thread.
+MemoryTag CPGE::getThreadTag()
+{
+  return threadTag;
+}
+
+#if defined(CPGE_MEMORY_TRACKING)
+// Route the global allocations through the tracker.
+void *operator new(size_t size)
+{
+  void *pointer = allocateTagged(size, static_cast<unsigned>(threadTag));
+  if (!pointer)
+    throw bad_alloc();
+  return pointer;
+}
+void *operator new[](size_t size)
+{
+  return operator new(size);
+}
+void *operator new(size_t size, const nothrow_t &) noexcept
+{
+  return allocateTagged(size, static_cast<unsigned>(threadTag));
+}
+void *operator new[](size_t size, const nothrow_t &) noexcept
+{
+  return allocateTagged(size, static_cast<unsigned>(threadTag));
+}
+void operator delete(void *pointer) noexcept
+{
+  deallocateTagged(pointer);
+}
+void operator delete[](void *pointer) noexcept
+{
+  deallocateTagged(pointer);
+}
+void operator delete(void *pointer, const nothrow_t &) noexcept
+{
+  deallocateTagged(pointer);
+}
+void operator delete[](void *pointer, const nothrow_t &) noexcept
+{
+  deallocateTagged(pointer);
+}
+#if defined(__cpp_sized_deallocation)
+void operator delete(void *pointer, size_t) noexcept
+{
+  deallocateTagged(pointer);
+}
+void operator delete[](void *pointer, size_t) noexcept
+{
+  deallocateTagged(pointer);
+}
+#endif
+#endif
+
+// Set the tag of the calling thread.
+MemoryTagScope::MemoryTagScope(MemoryTag tag) : previous(threadTag)
+{
+  threadTag = tag;
+}
+
+// Restore the previous tag.
+MemoryTagScope::~MemoryTagScope()
+{
+  threadTag = previous;
+}
+
@@ -0,0 +1,34 @@
+/// @file MemoryAllocator.hpp
+/// @author DP-Dev
+/// @brief The tagged allocator behind MemoryTracker, internal to the library.
+///
+/// These functions and the global operator new of CPGE_MEMORY_TRACKING live
+/// apart from MemoryTracker, without SDL, so a program that only links the
+/// replaced operator new doesn't need SDL.
+#ifndef MEMORY_ALLOCATOR_HPP
+#define MEMORY_ALLOCATOR_HPP true
+#include <CPGE/Memory.hpp>
+#include <cstddef>
+
+namespace CPGE
+{
+  /// @brief Allocate memory with a header that holds its size and tag.
+  /// @param size The number of bytes to allocate.
+  /// @param tag The index of the tag.
+  /// @return A pointer to the memory, or nullptr if there isn't enough.
+  void *allocateTagged(std::size_t size, unsigned tag);
+  /// @brief Free memory of allocateTagged(), it can be nullptr.
+  void deallocateTagged(void *pointer);
+  /// @brief Resize memory of allocateTagged(), keeping its tag.
+  /// @param pointer The memory to resize, or nullptr to allocate.
+  /// @param size The new size, zero frees the memory.
+  /// @param tag The index of the tag of a new allocation.
+  /// @return A pointer to the memory, or nullptr if there isn't enough.
+  void *reallocateTagged(void *pointer, std::size_t size, unsigned tag);
+  /// @brief Get the totals of a tag, with the counters of the calling thread.
+  MemoryStats getTaggedStats(unsigned tag);
+  /// @brief Get the tag of the calling thread.
+  MemoryTag getThreadTag();
+} // namespace CPGE
+
+#endif
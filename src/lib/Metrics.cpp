@@ -0,0 +1,405 @@
+// File: Metrics.cpp
+// Author: DP-Dev
+// Implementation of the metrics classes.
+#include <CPGE/Hints.hpp>
+#include <CPGE/Memory.hpp>
+#include <CPGE/Metrics.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+using namespace CPGE;
+using namespace std;
+
+// Set the reference to the unique instance of the class.
+MetricsRegistry &CPGE::theMetricsRegistry = MetricsRegistry::getInstace();
+
+namespace
+{
+  // The number of buckets per power of two, as a power of two.
+  const unsigned SUB_BUCKET_BITS = 4;
+  // The number of buckets per power of two.
+  const unsigned SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+
+  // The shards owned by running threads, one bit each.
+  atomic<unsigned> ownedShards(0);
+  // The shard of the calling thread plus one, zero until it's assigned. A
+  // constant initializer keeps the access as cheap as a plain load.
+  thread_local unsigned threadShard = 0;
+
+  // Give the shard of the thread back when the thread exits.
+  struct ShardOwner
+  {
+    // Take a free shard, or the shared one when every shard is owned.
+    void claim()
+    {
+      unsigned owned = ownedShards.load(memory_order_relaxed);
+      unsigned shard = 0;
+      while (shard < METRICS_SHARDS)
+      {
+        if (owned >> shard & 1)
+          ++shard;
+        // The previous owner's stores are seen by the new owner.
+        else if (ownedShards.compare_exchange_weak(owned,
+                   owned | 1u << shard, memory_order_acquire,
+                   memory_order_relaxed))
+          break;
+        else
+          shard = 0;
+      }
+      threadShard = shard + 1;
+    }
+    // Release the shard, later updates of the thread go to the shared one.
+    ~ShardOwner()
+    {
+      if (threadShard && threadShard - 1 < METRICS_SHARDS)
+        ownedShards.fetch_and(
+          ~(1u << (threadShard - 1)), memory_order_release);
+      threadShard = METRICS_SHARDS + 1;
+    }
+  };
+  thread_local ShardOwner shardOwner;
+
+  // Get the shard of the calling thread.
+  inline unsigned getShard()
+  {
+    if (!threadShard)
+      shardOwner.claim();
+    return threadShard - 1;
+  }
+
+  // Add to a value of a shard. An owned shard has a single writer, so a
+  // plain load and store replace the locked addition, the shared shard
+  // needs it.
+  inline void addToShard(atomic<Uint64> &part, Uint64 value, unsigned shard)
+  {
+    if (shard < METRICS_SHARDS)
+      part.store(part.load(memory_order_relaxed) + value,
+        memory_order_relaxed);
+    else
+      part.fetch_add(value, memory_order_relaxed);
+  }
+
+  // Get the index of the highest bit set in a non zero value.
+  unsigned getHighestBit(Uint64 value)
+  {
+#if defined(__GNUC__)
+    return 63 - static_cast<unsigned>(__builtin_clzll(value));
+#else
+    unsigned bit = 0;
+    while (value >>= 1)
+      ++bit;
+    return bit;
+#endif
+  }
+
+  // Append a formatted line to a list of lines.
+  void appendLine(vector<string> &lines, const char *fmt, ...)
+  {
+    char line[256];
+    va_list arguments;
+    va_start(arguments, fmt);
+    vsnprintf(line, sizeof(line), fmt, arguments);
+    va_end(arguments);
+    lines.push_back(line);
+  }
+} // namespace
+
+// Increase a counter.
+void Counter::add(Uint64 value)
+{
+  const unsigned shard = getShard();
+  addToShard(shards[shard].value, value, shard);
+}
+
+// Get the value of a counter.
+Uint64 Counter::get() const
+{
+  Uint64 value = 0;
+  for (const Shard &shard : shards)
+    value += shard.value.load(memory_order_relaxed);
+  return value;
+}
+
+// Set the value of a gauge.
+void Gauge::set(Sint64 value)
+{
+  this->value.store(value, memory_order_relaxed);
+}
+
+// Add to the value of a gauge.
+void Gauge::add(Sint64 value)
+{
+  this->value.fetch_add(value, memory_order_relaxed);
+}
+
+// Get the value of a gauge.
+Sint64 Gauge::get() const
+{
+  return value.load(memory_order_relaxed);
+}
+
+// Get a percentile of a histogram.
+Uint64 HistogramSnapshot::getPercentile(double percentile) const
+{
+  if (!count)
+    return 0;
+  // The rank of the value, starting at one.
+  Uint64 rank = static_cast<Uint64>(percentile / 100.0 * count + 0.5);
+  rank = rank < 1 ? 1 : (rank > count ? count : rank);
+  Uint64 seen = 0;
+  for (unsigned i = 0; i < buckets.size(); ++i)
+  {
+    seen += buckets[i];
+    if (seen >= rank)
+      return Histogram::getBucketLimit(i);
+  }
+  return getMaximum();
+}
+
+// Get the lowest value of a histogram.
+Uint64 HistogramSnapshot::getMinimum() const
+{
+  for (unsigned i = 0; i < buckets.size(); ++i)
+    if (buckets[i])
+      return Histogram::getBucketBase(i);
+  return 0;
+}
+
+// Get the highest value of a histogram.
+Uint64 HistogramSnapshot::getMaximum() const
+{
+  for (unsigned i = static_cast<unsigned>(buckets.size()); i > 0; --i)
+    if (buckets[i - 1])
+      return Histogram::getBucketLimit(i - 1);
+  return 0;
+}
+
+// Set the buckets of a shard to zero.
+Histogram::Shard::Shard()
+{
+  for (atomic<Uint64> &bucket : buckets)
+    bucket.store(0, memory_order_relaxed);
+}
+
+// Record a value.
+void Histogram::record(Uint64 value)
+{
+  const unsigned index = getShard();
+  Shard &shard = shards[index];
+  addToShard(shard.buckets[getBucket(value)], 1, index);
+  addToShard(shard.sum, value, index);
+}
+
+// Aggregate the recorded values.
+HistogramSnapshot Histogram::getSnapshot() const
+{
+  HistogramSnapshot snapshot;
+  snapshot.buckets.assign(BUCKETS, 0);
+  for (const Shard &shard : shards)
+  {
+    snapshot.sum += shard.sum.load(memory_order_relaxed);
+    for (unsigned i = 0; i < BUCKETS; ++i)
+      snapshot.buckets[i] += shard.buckets[i].load(memory_order_relaxed);
+  }
+  for (Uint64 bucket : snapshot.buckets)
+    snapshot.count += bucket;
+  return snapshot;
+}
+
+// Get the bucket of a value.
+unsigned Histogram::getBucket(Uint64 value)
+{
+  // Small values have a bucket each.
+  if (value < SUB_BUCKETS)
+    return static_cast<unsigned>(value);
+  // Keep the highest bits of the value.
+  const unsigned shift = getHighestBit(value) - SUB_BUCKET_BITS;
+  return (shift + 1) * SUB_BUCKETS +
+         static_cast<unsigned>((value >> shift) - SUB_BUCKETS);
+}
+
+// Get the lowest value of a bucket.
+Uint64 Histogram::getBucketBase(unsigned bucket)
+{
+  if (bucket < SUB_BUCKETS)
+    return bucket;
+  const unsigned shift = bucket / SUB_BUCKETS - 1;
+  return static_cast<Uint64>(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+}
+
+// Get the highest value of a bucket.
+Uint64 Histogram::getBucketLimit(unsigned bucket)
+{
+  if (bucket < SUB_BUCKETS)
+    return bucket;
+  const unsigned shift = bucket / SUB_BUCKETS - 1;
+  return getBucketBase(bucket) + ((static_cast<Uint64>(1) << shift) - 1);
+}
+
+// Stop the snapshots.
+MetricsRegistry::~MetricsRegistry()
+{
+  stopSnapshots();
+}
+
+// Get or create a counter.
+Counter &MetricsRegistry::getCounter(const string &name)
+{
+  MemoryTagScope scope(MemoryTag::METRICS);
+  lock_guard<std::mutex> lock(guard);
+  unique_ptr<Counter> &counter = counters[name];
+  if (!counter)
+    counter.reset(new Counter());
+  return *counter;
+}
+
+// Get or create a gauge.
+Gauge &MetricsRegistry::getGauge(const string &name)
+{
+  MemoryTagScope scope(MemoryTag::METRICS);
+  lock_guard<std::mutex> lock(guard);
+  unique_ptr<Gauge> &gauge = gauges[name];
+  if (!gauge)
+    gauge.reset(new Gauge());
+  return *gauge;
+}
+
+// Get or create a histogram.
+Histogram &MetricsRegistry::getHistogram(const string &name)
+{
+  MemoryTagScope scope(MemoryTag::METRICS);
+  lock_guard<std::mutex> lock(guard);
+  unique_ptr<Histogram> &histogram = histograms[name];
+  if (!histogram)
+    histogram.reset(new Histogram());
+  return *histogram;
+}
+
+// Set the category of the snapshots.
+void MetricsRegistry::setCategory(const LogCategory &category)
+{
+  lock_guard<std::mutex> lock(guard);
+  this->category = category;
+}
+
+// Write a snapshot of all the metrics.
+void MetricsRegistry::writeSnapshot()
+{
+  MemoryTagScope scope(MemoryTag::METRICS);
+  vector<string> lines;
+  LogCategory category;
+  {
+    // Read the metrics while holding the lock, the values are read without
+    // stopping the writers.
+    lock_guard<std::mutex> lock(guard);
+    category = this->category;
+    appendLine(lines, "# %llu",
+      static_cast<unsigned long long>(SDL_GetTicks64()));
+    for (const auto &counter : counters)
+      appendLine(lines, "c %s %llu", counter.first.c_str(),
+        static_cast<unsigned long long>(counter.second->get()));
+    for (const auto &gauge : gauges)
+      appendLine(lines, "g %s %lld", gauge.first.c_str(),
+        static_cast<long long>(gauge.second->get()));
+    for (const auto &histogram : histograms)
+    {
+      const HistogramSnapshot snapshot = histogram.second->getSnapshot();
+      appendLine(lines, "h %s %llu %llu %llu %llu %llu %llu %llu %llu",
+        histogram.first.c_str(),
+        static_cast<unsigned long long>(snapshot.count),
+        static_cast<unsigned long long>(snapshot.sum),
+        static_cast<unsigned long long>(snapshot.getMinimum()),
+        static_cast<unsigned long long>(snapshot.getPercentile(50.0)),
+        static_cast<unsigned long long>(snapshot.getPercentile(90.0)),
+        static_cast<unsigned long long>(snapshot.getPercentile(99.0)),
+        static_cast<unsigned long long>(snapshot.getPercentile(99.9)),
+        static_cast<unsigned long long>(snapshot.getMaximum()));
+    }
+  }
+  // Append to the file when there is one.
+  const string path = theHintsManager.get(CPGE_HINT_METRICS_FILE);
+  if (!path.empty())
+  {
+    FILE *file = fopen(path.c_str(), "a");
+    if (file)
+    {
+      for (const string &line : lines)
+        fprintf(file, "%s\n", line.c_str());
+      fclose(file);
+      return;
+    }
+    theLog.printError(
+      LogCategory::ERROR, "Metrics: can't open %s", path.c_str());
+  }
+  for (const string &line : lines)
+    theLog.printInfo(category, "%s", line.c_str());
+}
+
+// Start the background thread.
+void MetricsRegistry::startSnapshots()
+{
+  if (thread.joinable())
+    return;
+  stopping = false;
+  // SDL calls the function with the current value right away.
+  theHintsManager.addCallback(
+    CPGE_HINT_METRICS_INTERVAL, MetricsRegistry::intervalChanged, this);
+  thread = std::thread(&MetricsRegistry::run, this);
+}
+
+// Stop the background thread.
+void MetricsRegistry::stopSnapshots()
+{
+  if (!thread.joinable())
+    return;
+  theHintsManager.delCallback(
+    CPGE_HINT_METRICS_INTERVAL, MetricsRegistry::intervalChanged, this);
+  {
+    lock_guard<std::mutex> lock(guard);
+    stopping = true;
+  }
+  wakeUp.notify_all();
+  thread.join();
+}
+
+// Get the unique instance of the class.
+MetricsRegistry &MetricsRegistry::getInstace()
+{
+  static MetricsRegistry theMetricsRegistry;
+  return theMetricsRegistry;
+}
+
+// Update the interval.
+void SDLCALL MetricsRegistry::intervalChanged(
+  void *userdata, const char *, const char *, const char *newValue)
+{
+  MetricsRegistry *registry = static_cast<MetricsRegistry *>(userdata);
+  {
+    lock_guard<std::mutex> lock(registry->guard);
+    registry->interval =
+      newValue ? static_cast<Uint32>(strtoul(newValue, nullptr, 10)) : 10000;
+  }
+  registry->wakeUp.notify_all();
+}
+
+// Write snapshots until stopped.
+void MetricsRegistry::run()
+{
+  unique_lock<std::mutex> lock(guard);
+  while (!stopping)
+  {
+    // A paused registry waits for a new interval.
+    if (!interval)
+    {
+      wakeUp.wait(lock);
+      continue;
+    }
+    // A notification restarts the wait with the new interval.
+    if (wakeUp.wait_for(lock, chrono::milliseconds(interval)) ==
+        cv_status::no_timeout)
+      continue;
+    lock.unlock();
+    writeSnapshot();
+    lock.lock();
+  }
+}
@@ -0,0 +1,442 @@
+// File: Mixer.cpp
+// Author: DP-Dev
+// Implementation of the classes Sound and Mixer.
+#include "Simd.hpp"
+#include <CPGE/Log.hpp>
+#include <CPGE/Memory.hpp>
+#include <CPGE/Mixer.hpp>
+#include <CPGE/Startup.hpp>
+#include <algorithm>
+using namespace CPGE;
+using namespace std;
+
+namespace
+{
+  // One frame in 32.32 fixed point.
+  const Uint64 ONE_FRAME = static_cast<Uint64>(1) << 32;
+
+  // Add count samples scaled by volume to out.
+  void mixAdd(float *out, const float *in, size_t count, float volume)
+  {
+    size_t i = 0;
+#if defined(CPGE_SIMD_SSE2)
+    const __m128 gain = _mm_set1_ps(volume);
+    for (; i + 4 <= count; i += 4)
+      _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i),
+                               _mm_mul_ps(_mm_loadu_ps(in + i), gain)));
+#elif defined(CPGE_SIMD_NEON)
+    for (; i + 4 <= count; i += 4)
+      vst1q_f32(out + i, vmlaq_n_f32(vld1q_f32(out + i), vld1q_f32(in + i),
+                           volume));
+#endif
+    for (; i < count; ++i)
+      out[i] += in[i] * volume;
+  }
+
+  // Add frames of stereo samples resampled with linear interpolation to out,
+  // the frame after every position read must exist.
+  void mixResampled(float *out, const float *in, Uint64 position, Uint64 step,
+    size_t frames, float volume)
+  {
+    size_t i = 0;
+#if defined(CPGE_SIMD_SSE2)
+    // Interpolate two frames at a time.
+    const __m128 gain = _mm_set1_ps(volume);
+    const float scale = 1.0f / static_cast<float>(ONE_FRAME);
+    for (; i + 2 <= frames; i += 2, position += 2 * step)
+    {
+      const Uint64 next = position + step;
+      const float *a = in + (position >> 32) * 2;
+      const float *b = in + (next >> 32) * 2;
+      // The left and right samples of both frames and of the frames after.
+      __m128 current = _mm_setzero_ps();
+      __m128 following = _mm_setzero_ps();
+      current = _mm_loadl_pi(current, reinterpret_cast<const __m64 *>(a));
+      current = _mm_loadh_pi(current, reinterpret_cast<const __m64 *>(b));
+      following =
+        _mm_loadl_pi(following, reinterpret_cast<const __m64 *>(a + 2));
+      following =
+        _mm_loadh_pi(following, reinterpret_cast<const __m64 *>(b + 2));
+      const float fa = static_cast<float>(position & (ONE_FRAME - 1)) * scale;
+      const float fb = static_cast<float>(next & (ONE_FRAME - 1)) * scale;
+      const __m128 fraction = _mm_set_ps(fb, fb, fa, fa);
+      const __m128 sample = _mm_add_ps(
+        current, _mm_mul_ps(_mm_sub_ps(following, current), fraction));
+      _mm_storeu_ps(out + i * 2,
+        _mm_add_ps(_mm_loadu_ps(out + i * 2), _mm_mul_ps(sample, gain)));
+    }
+#endif
+    for (; i < frames; ++i, position += step)
+    {
+      const float *a = in + (position >> 32) * 2;
+      const float fraction = static_cast<float>(position & (ONE_FRAME - 1)) /
+                             static_cast<float>(ONE_FRAME);
+      out[i * 2] += (a[0] + (a[2] - a[0]) * fraction) * volume;
+      out[i * 2 + 1] += (a[1] + (a[3] - a[1]) * fraction) * volume;
+    }
+  }
+
+  // Scale count samples by volume and clamp them to [-1, 1].
+  void finish(float *out, size_t count, float volume)
+  {
+    size_t i = 0;
+#if defined(CPGE_SIMD_SSE2)
+    const __m128 gain = _mm_set1_ps(volume);
+    const __m128 low = _mm_set1_ps(-1.0f);
+    const __m128 high = _mm_set1_ps(1.0f);
+    for (; i + 4 <= count; i += 4)
+      _mm_storeu_ps(out + i, _mm_min_ps(high, _mm_max_ps(low,
+                               _mm_mul_ps(_mm_loadu_ps(out + i), gain))));
+#elif defined(CPGE_SIMD_NEON)
+    const float32x4_t low = vdupq_n_f32(-1.0f);
+    const float32x4_t high = vdupq_n_f32(1.0f);
+    for (; i + 4 <= count; i += 4)
+      vst1q_f32(out + i, vminq_f32(high, vmaxq_f32(low,
+                           vmulq_n_f32(vld1q_f32(out + i), volume))));
+#endif
+    for (; i < count; ++i)
+      out[i] = min(1.0f, max(-1.0f, out[i] * volume));
+  }
+} // namespace
+
+// Load a sound from a WAVE file.
+bool Sound::loadWAV(const string &path)
+{
+  MemoryTagScope scope(MemoryTag::AUDIO);
+  SDL_AudioSpec spec;
+  Uint8 *buffer = nullptr;
+  Uint32 length = 0;
+  if (!SDL_LoadWAV(path.c_str(), &spec, &buffer, &length))
+  {
+    theLog.printError(LogCategory::AUDIO, "Sound: can't load %s: %s",
+      path.c_str(), SDL_GetError());
+    return false;
+  }
+  // Convert to float stereo keeping the sample rate, the mixer resamples.
+  SDL_AudioCVT converter;
+  if (SDL_BuildAudioCVT(&converter, spec.format, spec.channels, spec.freq,
+        AUDIO_F32SYS, 2, spec.freq) < 0)
+  {
+    theLog.printError(LogCategory::AUDIO, "Sound: can't convert %s: %s",
+      path.c_str(), SDL_GetError());
+    SDL_FreeWAV(buffer);
+    return false;
+  }
+  vector<Uint8> data(static_cast<size_t>(length) * converter.len_mult);
+  SDL_memcpy(data.data(), buffer, length);
+  SDL_FreeWAV(buffer);
+  converter.buf = data.data();
+  converter.len = static_cast<int>(length);
+  converter.len_cvt = static_cast<int>(length);
+  if (converter.needed && SDL_ConvertAudio(&converter))
+  {
+    theLog.printError(LogCategory::AUDIO, "Sound: can't convert %s: %s",
+      path.c_str(), SDL_GetError());
+    return false;
+  }
+  load(reinterpret_cast<const float *>(data.data()),
+    converter.len_cvt / (2 * sizeof(float)), spec.freq);
+  return true;
+}
+
+// Load a sound from samples.
+void Sound::load(const float *samples, size_t frames, int frequency)
+{
+  MemoryTagScope scope(MemoryTag::AUDIO);
+  this->samples.assign(samples, samples + frames * 2);
+  this->frequency = frequency;
+}
+
+// Get the samples.
+const float *Sound::getSamples() const
+{
+  return samples.data();
+}
+
+// Get the number of frames.
+size_t Sound::getFrames() const
+{
+  return samples.size() / 2;
+}
+
+// Get the sample rate.
+int Sound::getFrequency() const
+{
+  return frequency;
+}
+
+// Close the device.
+Mixer::~Mixer()
+{
+  close();
+}
+
+// Open an audio device.
+bool Mixer::open(int frequency, Uint16 samples, const char *device)
+{
+  close();
+  if (!theStartupManager.requireSubsystems(SDL_INIT_AUDIO))
+    return false;
+  SDL_AudioSpec desired = {};
+  desired.freq = frequency;
+  desired.format = AUDIO_F32SYS;
+  desired.channels = 2;
+  desired.samples = samples;
+  desired.callback = Mixer::callback;
+  desired.userdata = this;
+  SDL_AudioSpec obtained;
+  // The format and the channels are fixed, the mixer adapts to the rest.
+  this->device = SDL_OpenAudioDevice(device, 0, &desired, &obtained,
+    SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_SAMPLES_CHANGE);
+  if (!this->device)
+  {
+    theLog.printError(LogCategory::AUDIO,
+      "Mixer: can't open the audio device: %s", SDL_GetError());
+    return false;
+  }
+  this->frequency.store(obtained.freq);
+  bufferFrames.store(obtained.samples);
+  theLog.printInfo(LogCategory::AUDIO, "Mixer: %d Hz, %d frames per buffer",
+    obtained.freq, static_cast<int>(obtained.samples));
+  SDL_PauseAudioDevice(this->device, 0);
+  return true;
+}
+
+// Close the device.
+void Mixer::close()
+{
+  if (!device)
+    return;
+  SDL_CloseAudioDevice(device);
+  device = 0;
+}
+
+// Play a sound.
+VoiceID Mixer::play(const Sound &sound, float volume, float pitch, bool loop)
+{
+  // Skip zero when the identifiers wrap around.
+  if (!++lastVoice)
+    ++lastVoice;
+  if (!send({CommandType::PLAY, lastVoice, &sound, volume, pitch, loop}))
+    return 0;
+  return lastVoice;
+}
+
+// Stop a voice.
+bool Mixer::stop(VoiceID voice)
+{
+  return send({CommandType::STOP, voice, nullptr, 0.0f, 0.0f, false});
+}
+
+// Stop all the voices.
+bool Mixer::stopAll()
+{
+  return send({CommandType::STOP_ALL, 0, nullptr, 0.0f, 0.0f, false});
+}
+
+// Change the volume of a voice.
+bool Mixer::setVolume(VoiceID voice, float volume)
+{
+  return send({CommandType::VOLUME, voice, nullptr, volume, 0.0f, false});
+}
+
+// Change the volume of the mix.
+bool Mixer::setMasterVolume(float volume)
+{
+  return send({CommandType::MASTER_VOLUME, 0, nullptr, volume, 0.0f, false});
+}
+
+// Mix the playing voices.
+void Mixer::mix(float *stream, size_t frames)
+{
+  runCommands();
+  SDL_memset(stream, 0, frames * 2 * sizeof(float));
+  unsigned active = 0;
+  for (Voice &voice : voices)
+  {
+    if (!voice.id)
+      continue;
+    if (mixVoice(voice, stream, frames))
+      ++active;
+    else
+      voice.id = 0;
+  }
+  finish(stream, frames * 2, masterVolume);
+  activeVoices.store(active, memory_order_relaxed);
+}
+
+// Get the statistics.
+MixerStats Mixer::getStats() const
+{
+  const double ticksPerSecond =
+    static_cast<double>(SDL_GetPerformanceFrequency());
+  MixerStats stats;
+  stats.callbacks = callbacks.load(memory_order_relaxed);
+  stats.underruns = underruns.load(memory_order_relaxed);
+  stats.droppedCommands = droppedCommands.load(memory_order_relaxed);
+  stats.droppedVoices = droppedVoices.load(memory_order_relaxed);
+  stats.averageCallbackTime =
+    stats.callbacks ? static_cast<double>(callbackTicks.load()) /
+                        static_cast<double>(stats.callbacks) / ticksPerSecond
+                    : 0.0;
+  stats.maximumCallbackTime =
+    static_cast<double>(maximumCallbackTicks.load()) / ticksPerSecond;
+  stats.bufferDuration = static_cast<double>(bufferFrames.load()) /
+                         static_cast<double>(frequency.load());
+  stats.activeVoices = activeVoices.load(memory_order_relaxed);
+  return stats;
+}
+
+// Print the statistics.
+void Mixer::logStats() const
+{
+  const MixerStats stats = getStats();
+  theLog.printInfo(LogCategory::AUDIO,
+    "Mixer: %lu callbacks, %lu underruns, callback %.3f ms average, %.3f ms "
+    "maximum, %.3f ms buffer, %u voices, %lu dropped commands, %lu dropped "
+    "voices",
+    static_cast<unsigned long>(stats.callbacks),
+    static_cast<unsigned long>(stats.underruns),
+    stats.averageCallbackTime * 1000.0, stats.maximumCallbackTime * 1000.0,
+    stats.bufferDuration * 1000.0, stats.activeVoices,
+    static_cast<unsigned long>(stats.droppedCommands),
+    static_cast<unsigned long>(stats.droppedVoices));
+}
+
+// The SDL audio callback.
+void SDLCALL Mixer::callback(void *userdata, Uint8 *stream, int length)
+{
+  Mixer *mixer = static_cast<Mixer *>(userdata);
+  const Uint64 start = SDL_GetPerformanceCounter();
+  const size_t frames = static_cast<size_t>(length) / (2 * sizeof(float));
+  mixer->mix(reinterpret_cast<float *>(stream), frames);
+  const Uint64 ticks = SDL_GetPerformanceCounter() - start;
+  // Only this thread writes the statistics, no read-modify-write is needed.
+  mixer->callbacks.store(mixer->callbacks.load(memory_order_relaxed) + 1,
+    memory_order_relaxed);
+  mixer->callbackTicks.store(
+    mixer->callbackTicks.load(memory_order_relaxed) + ticks,
+    memory_order_relaxed);
+  if (ticks > mixer->maximumCallbackTicks.load(memory_order_relaxed))
+    mixer->maximumCallbackTicks.store(ticks, memory_order_relaxed);
+  // The device starves when filling a buffer takes longer than playing it.
+  const Uint64 budget = frames * SDL_GetPerformanceFrequency() /
+                        static_cast<Uint64>(mixer->frequency.load());
+  if (ticks > budget)
+    mixer->underruns.store(mixer->underruns.load(memory_order_relaxed) + 1,
+      memory_order_relaxed);
+}
+
+// Send a command to the audio callback.
+bool Mixer::send(const Command &command)
+{
+  if (commands.push(command))
+    return true;
+  droppedCommands.fetch_add(1, memory_order_relaxed);
+  return false;
+}
+
+// Run the pending commands.
+void Mixer::runCommands()
+{
+  Command command;
+  while (commands.pop(command))
+  {
+    switch (command.type)
+    {
+    case CommandType::PLAY:
+    {
+      // Take the first free voice.
+      Voice *voice = find_if(begin(voices), end(voices),
+        [](const Voice &slot) { return !slot.id; });
+      if (voice == end(voices) || !command.sound->getFrames())
+      {
+        droppedVoices.fetch_add(1, memory_order_relaxed);
+        break;
+      }
+      const double ratio =
+        static_cast<double>(command.sound->getFrequency()) /
+        static_cast<double>(frequency.load(memory_order_relaxed));
+      voice->id = command.voice;
+      voice->samples = command.sound->getSamples();
+      voice->frames = command.sound->getFrames();
+      voice->position = 0;
+      voice->step = static_cast<Uint64>(
+        ratio * max(command.pitch, 0.0f) * static_cast<double>(ONE_FRAME));
+      voice->step = max<Uint64>(voice->step, 1);
+      voice->volume = command.volume;
+      voice->loop = command.loop;
+      break;
+    }
+    case CommandType::STOP:
+    case CommandType::VOLUME:
+      for (Voice &voice : voices)
+      {
+        if (voice.id != command.voice)
+          continue;
+        if (command.type == CommandType::STOP)
+          voice.id = 0;
+        else
+          voice.volume = command.volume;
+        break;
+      }
+      break;
+    case CommandType::STOP_ALL:
+      for (Voice &voice : voices)
+        voice.id = 0;
+      break;
+    case CommandType::MASTER_VOLUME:
+      masterVolume = command.volume;
+      break;
+    }
+  }
+}
+
+// Add a voice to the mix.
+bool Mixer::mixVoice(Voice &voice, float *stream, size_t frames)
+{
+  const Uint64 end = static_cast<Uint64>(voice.frames) << 32;
+  // Positions before the last frame can be interpolated with the next one.
+  const Uint64 safeEnd = end - ONE_FRAME;
+  size_t done = 0;
+  while (done < frames)
+  {
+    if (voice.position >= end)
+    {
+      if (!voice.loop)
+        return false;
+      voice.position %= end;
+    }
+    const size_t remaining = frames - done;
+    float *out = stream + done * 2;
+    size_t count = 1;
+    if (voice.step == ONE_FRAME && !(voice.position & (ONE_FRAME - 1)))
+    {
+      // Same rate, add the samples directly.
+      const size_t index = static_cast<size_t>(voice.position >> 32);
+      count = min(remaining, voice.frames - index);
+      mixAdd(out, voice.samples + index * 2, count * 2, voice.volume);
+    }
+    else if (voice.position < safeEnd)
+    {
+      count = static_cast<size_t>(min<Uint64>(
+        remaining, (safeEnd - voice.position + voice.step - 1) / voice.step));
+      mixResampled(
+        out, voice.samples, voice.position, voice.step, count, voice.volume);
+    }
+    else
+    {
+      // The last frame is interpolated with the first one when looping.
+      const float *a = voice.samples + (voice.frames - 1) * 2;
+      const float *b = voice.loop ? voice.samples : a;
+      const float fraction =
+        static_cast<float>(voice.position & (ONE_FRAME - 1)) /
+        static_cast<float>(ONE_FRAME);
+      out[0] += (a[0] + (b[0] - a[0]) * fraction) * voice.volume;
+      out[1] += (a[1] + (b[1] - a[1]) * fraction) * voice.volume;
+    }
+    voice.position += count * voice.step;
+    done += count;
+  }
+  return voice.loop || voice.position < end;
+}
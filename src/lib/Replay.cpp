@@ -0,0 +1,459 @@
+// File: Replay.cpp
+// Author: DP-Dev
+// Implementation of the classes InputRecorder and InputReplayer.
+#include <CPGE/Endian.hpp>
+#include <CPGE/Hints.hpp>
+#include <CPGE/Log.hpp>
+#include <CPGE/Memory.hpp>
+#include <CPGE/Replay.hpp>
+#include <algorithm>
+#include <cstring>
+using namespace CPGE;
+using namespace std;
+
+namespace
+{
+  // The text at the start of a recording, before the version.
+  const char MAGIC[] = "CPGEREC";
+  // The version of the recording format.
+  const Uint8 VERSION = 2;
+  // The size of the data that makes the recorder write to the file.
+  const size_t BUFFER_SIZE = 64 * 1024;
+
+  // The kinds of data after the header.
+  enum : Uint8
+  {
+    // The start of a frame, its time in microseconds and, from version 2,
+    // the number of events before it that the frame polls.
+    CHUNK_FRAME = 1,
+    // An SDL_Event as it is in memory.
+    CHUNK_EVENT = 2,
+    // The name and the value of a hint.
+    CHUNK_HINT = 3
+  };
+
+  // Whether an event can be replayed, the ones with pointers can't.
+  bool isReplayable(Uint32 type)
+  {
+    switch (type)
+    {
+    case SDL_SYSWMEVENT:
+    case SDL_DROPFILE:
+    case SDL_DROPTEXT:
+#if SDL_VERSION_ATLEAST(2, 0, 22)
+    case SDL_TEXTEDITING_EXT:
+#endif
+      return false;
+    default:
+      return type < SDL_USEREVENT;
+    }
+  }
+
+  // Count the replayable events in the SDL queue.
+  Uint32 countQueuedEvents()
+  {
+    const int count = SDL_PeepEvents(
+      nullptr, 0, SDL_PEEKEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT);
+    if (count <= 0)
+      return 0;
+    vector<SDL_Event> events(count);
+    const int peeked = SDL_PeepEvents(
+      events.data(), count, SDL_PEEKEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT);
+    Uint32 queued = 0;
+    for (int i = 0; i < peeked; ++i)
+      queued += isReplayable(events[i].type);
+    return queued;
+  }
+
+  // Append a string after its length.
+  void appendString(vector<Uint8> &bytes, const string &text)
+  {
+    appendLittleEndian(bytes, text.size(), 4);
+    bytes.insert(bytes.end(), text.begin(), text.end());
+  }
+} // namespace
+
+// Stop the recording.
+InputRecorder::~InputRecorder()
+{
+  stop();
+}
+
+// Create a file and start recording.
+bool InputRecorder::start(const string &path, const vector<string> &hints)
+{
+  stop();
+  MemoryTagScope scope(MemoryTag::APPLICATION);
+  file = fopen(path.c_str(), "wb");
+  if (!file)
+  {
+    theLog.printError(
+      LogCategory::INPUT, "InputRecorder: can't open %s", path.c_str());
+    return false;
+  }
+  {
+    lock_guard<std::mutex> lock(guard);
+    buffer.clear();
+    this->hints.clear();
+    events = 0;
+    frameEvents = 0;
+    failed = false;
+    // The header lets the replayer reject recordings of another SDL.
+    SDL_version version;
+    SDL_GetVersion(&version);
+    buffer.insert(buffer.end(), MAGIC, MAGIC + sizeof(MAGIC) - 1);
+    buffer.push_back(VERSION);
+    buffer.push_back(version.major);
+    buffer.push_back(version.minor);
+    buffer.push_back(version.patch);
+    appendLittleEndian(buffer, sizeof(SDL_Event), 4);
+    for (const string &name : hints)
+      appendHint(name, theHintsManager.get(name));
+    origin = SDL_GetPerformanceCounter();
+  }
+  // SDL calls the functions with the current values, they are skipped
+  // because the values didn't change.
+  for (const string &name : hints)
+    theHintsManager.addCallback(name, InputRecorder::hintChanged, this);
+  SDL_AddEventWatch(InputRecorder::watch, this);
+  return true;
+}
+
+// Stop recording.
+void InputRecorder::stop()
+{
+  if (!file)
+    return;
+  SDL_DelEventWatch(InputRecorder::watch, this);
+  vector<string> names;
+  {
+    lock_guard<std::mutex> lock(guard);
+    for (const auto &hint : hints)
+      names.push_back(hint.first);
+  }
+  for (const string &name : names)
+    theHintsManager.delCallback(name, InputRecorder::hintChanged, this);
+  lock_guard<std::mutex> lock(guard);
+  writeBuffer();
+  if (fclose(file) || failed)
+    theLog.printError(
+      LogCategory::INPUT, "InputRecorder: the recording is incomplete");
+  file = nullptr;
+}
+
+// Record the start of a frame.
+void InputRecorder::markFrame()
+{
+  const Uint64 elapsed = SDL_GetPerformanceCounter() - origin;
+  const Uint64 time = static_cast<Uint64>(static_cast<double>(elapsed) *
+                                          1000000.0 /
+                                          SDL_GetPerformanceFrequency());
+  // The events still queued were recorded before the marker, but this frame
+  // polls them. The queue is read without the lock, SDL may call the watch
+  // while it holds its own.
+  MemoryTagScope scope(MemoryTag::APPLICATION);
+  const Uint32 queued = countQueuedEvents();
+  lock_guard<std::mutex> lock(guard);
+  if (!file)
+    return;
+  buffer.push_back(CHUNK_FRAME);
+  appendLittleEndian(buffer, time, 8);
+  appendLittleEndian(buffer, min(queued, frameEvents), 4);
+  frameEvents = 0;
+  if (buffer.size() >= BUFFER_SIZE)
+    writeBuffer();
+}
+
+// Get the number of events recorded.
+Uint64 InputRecorder::getEvents()
+{
+  lock_guard<std::mutex> lock(guard);
+  return events;
+}
+
+// Record an event.
+int SDLCALL InputRecorder::watch(void *userdata, SDL_Event *event)
+{
+  if (!isReplayable(event->type))
+    return 1;
+  InputRecorder *recorder = static_cast<InputRecorder *>(userdata);
+  MemoryTagScope scope(MemoryTag::APPLICATION);
+  lock_guard<std::mutex> lock(recorder->guard);
+  if (!recorder->file)
+    return 1;
+  const Uint8 *bytes = reinterpret_cast<const Uint8 *>(event);
+  recorder->buffer.push_back(CHUNK_EVENT);
+  recorder->buffer.insert(
+    recorder->buffer.end(), bytes, bytes + sizeof(SDL_Event));
+  ++recorder->events;
+  ++recorder->frameEvents;
+  if (recorder->buffer.size() >= BUFFER_SIZE)
+    recorder->writeBuffer();
+  return 1;
+}
+
+// Record the change of a hint.
+void SDLCALL InputRecorder::hintChanged(
+  void *userdata, const char *name, const char *, const char *newValue)
+{
+  InputRecorder *recorder = static_cast<InputRecorder *>(userdata);
+  MemoryTagScope scope(MemoryTag::APPLICATION);
+  lock_guard<std::mutex> lock(recorder->guard);
+  if (!recorder->file || recorder->hints[name] == (newValue ? newValue : ""))
+    return;
+  recorder->appendHint(name, newValue ? newValue : "");
+}
+
+// Append a hint to the buffer.
+void InputRecorder::appendHint(const string &name, const string &value)
+{
+  hints[name] = value;
+  buffer.push_back(CHUNK_HINT);
+  appendString(buffer, name);
+  appendString(buffer, value);
+}
+
+// Write the buffer to the file.
+bool InputRecorder::writeBuffer()
+{
+  if (fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size())
+    failed = true;
+  buffer.clear();
+  return !failed;
+}
+
+// Open a recording.
+bool InputReplayer::open(const string &path)
+{
+  MemoryTagScope scope(MemoryTag::APPLICATION);
+  data.clear();
+  offset = 0;
+  events.clear();
+  held.clear();
+  hasFrame = false;
+  time = 0;
+  deltaTime = 0.0;
+  frames = 0;
+  frameTimes.clear();
+  FILE *file = fopen(path.c_str(), "rb");
+  if (!file)
+  {
+    theLog.printError(
+      LogCategory::INPUT, "InputReplayer: can't open %s", path.c_str());
+    return false;
+  }
+  Uint8 chunk[BUFFER_SIZE];
+  size_t count;
+  while ((count = fread(chunk, 1, sizeof(chunk), file)) > 0)
+    data.insert(data.end(), chunk, chunk + count);
+  fclose(file);
+  // Check the header.
+  Uint8 header[sizeof(MAGIC) + 7];
+  if (!read(header, sizeof(header)) ||
+      memcmp(header, MAGIC, sizeof(MAGIC) - 1) ||
+      !header[sizeof(MAGIC) - 1] || header[sizeof(MAGIC) - 1] > VERSION)
+  {
+    theLog.printError(LogCategory::INPUT,
+      "InputReplayer: %s isn't a recording", path.c_str());
+    return false;
+  }
+  version = header[sizeof(MAGIC) - 1];
+  const Uint8 *recorded = header + sizeof(MAGIC);
+  const Uint64 eventSize = readLittleEndian(recorded + 3, 4);
+  if (eventSize != sizeof(SDL_Event))
+  {
+    theLog.printError(LogCategory::INPUT,
+      "InputReplayer: %s was recorded with another SDL_Event layout",
+      path.c_str());
+    return false;
+  }
+  SDL_version version;
+  SDL_GetVersion(&version);
+  if (version.major != recorded[0] || version.minor != recorded[1] ||
+      version.patch != recorded[2])
+    theLog.printWarn(LogCategory::INPUT,
+      "InputReplayer: %s was recorded with SDL %u.%u.%u", path.c_str(),
+      recorded[0], recorded[1], recorded[2]);
+  // Apply the hints saved at the start.
+  return readFrame();
+}
+
+// Start the next frame.
+bool InputReplayer::nextFrame()
+{
+  const Uint64 now = SDL_GetPerformanceCounter();
+  // End the current frame, the calls after the end of the recording have no
+  // frame to end.
+  if (frameTimes.size() < frames)
+    frameTimes.push_back(now - frameStart);
+  frameStart = now;
+  if (!hasFrame)
+    return false;
+  deltaTime = frames ? static_cast<double>(nextTime - time) / 1000000.0 : 0.0;
+  time = nextTime;
+  ++frames;
+  // A damaged recording ends after this frame.
+  readFrame();
+  return true;
+}
+
+// Get the recorded time of the frame.
+double InputReplayer::getDeltaTime() const
+{
+  return deltaTime;
+}
+
+// Get the number of frames started.
+Uint64 InputReplayer::getFrames() const
+{
+  return frames;
+}
+
+// Get the measured frame times.
+vector<double> InputReplayer::getFrameTimes() const
+{
+  const double frequency =
+    static_cast<double>(SDL_GetPerformanceFrequency());
+  vector<double> seconds;
+  seconds.reserve(frameTimes.size());
+  for (Uint64 frameTime : frameTimes)
+    seconds.push_back(static_cast<double>(frameTime) / frequency);
+  return seconds;
+}
+
+// Print the frame times.
+void InputReplayer::logReport(bool perFrame)
+{
+  if (frameTimes.empty())
+    return;
+  vector<Uint64> sorted = frameTimes;
+  sort(sorted.begin(), sorted.end());
+  const double toMilliseconds =
+    1000.0 / static_cast<double>(SDL_GetPerformanceFrequency());
+  double total = 0.0;
+  for (Uint64 frameTime : sorted)
+    total += static_cast<double>(frameTime);
+  // The nearest rank of a percentile.
+  auto percentile = [&sorted, toMilliseconds](double value) {
+    size_t rank = static_cast<size_t>(value / 100.0 * sorted.size() + 0.5);
+    rank = rank < 1 ? 1 : (rank > sorted.size() ? sorted.size() : rank);
+    return static_cast<double>(sorted[rank - 1]) * toMilliseconds;
+  };
+  theLog.printInfo(LogCategory::TEST,
+    "Replay: %lu frames, min %.3f ms, avg %.3f ms, p50 %.3f ms, "
+    "p95 %.3f ms, p99 %.3f ms, max %.3f ms",
+    static_cast<unsigned long>(sorted.size()),
+    static_cast<double>(sorted.front()) * toMilliseconds,
+    total / sorted.size() * toMilliseconds, percentile(50.0),
+    percentile(95.0), percentile(99.0),
+    static_cast<double>(sorted.back()) * toMilliseconds);
+  if (!perFrame)
+    return;
+  for (size_t i = 0; i < frameTimes.size(); ++i)
+    theLog.printInfo(LogCategory::TEST, "Replay: frame %lu %.3f ms",
+      static_cast<unsigned long>(i + 1),
+      static_cast<double>(frameTimes[i]) * toMilliseconds);
+}
+
+// Use the dummy drivers.
+void InputReplayer::useHeadlessDrivers()
+{
+  theHintsManager.setWithPriority("SDL_VIDEODRIVER", "dummy");
+  theHintsManager.setWithPriority("SDL_AUDIODRIVER", "dummy");
+}
+
+// Apply the data until the next frame marker.
+bool InputReplayer::readFrame()
+{
+  hasFrame = false;
+  // The events held back by the previous marker go first, as in the queue.
+  pushEvents(held.data(), held.size());
+  held.clear();
+  events.clear();
+  while (offset < data.size())
+  {
+    const Uint8 chunk = data[offset++];
+    if (chunk == CHUNK_FRAME)
+    {
+      // Recordings of version 1 don't count the queued events.
+      Uint8 bytes[12] = {};
+      if (read(bytes, version < 2 ? 8 : 12))
+      {
+        nextTime = readLittleEndian(bytes, 8);
+        const size_t queued =
+          static_cast<size_t>(readLittleEndian(bytes + 8, 4));
+        // The events still queued at the marker are polled by the next
+        // frame, so they are pushed at its start.
+        const size_t polled = events.size() - min(queued, events.size());
+        pushEvents(events.data(), polled);
+        held.assign(events.begin() + polled, events.end());
+        hasFrame = true;
+        return true;
+      }
+    }
+    else if (chunk == CHUNK_EVENT)
+    {
+      SDL_Event event;
+      if (read(&event, sizeof(event)))
+      {
+        events.push_back(event);
+        continue;
+      }
+    }
+    else if (chunk == CHUNK_HINT && readHint())
+      continue;
+    pushEvents(events.data(), events.size());
+    theLog.printError(
+      LogCategory::INPUT, "InputReplayer: the recording is damaged");
+    offset = data.size();
+    return false;
+  }
+  pushEvents(events.data(), events.size());
+  return true;
+}
+
+// Push events to the SDL queue.
+void InputReplayer::pushEvents(const SDL_Event *queue, size_t count)
+{
+  for (size_t i = 0; i < count; ++i)
+  {
+    // SDL_PushEvent() takes a pointer to a mutable event.
+    SDL_Event event = queue[i];
+    if (SDL_PushEvent(&event) < 0)
+      theLog.printError(LogCategory::INPUT,
+        "InputReplayer: can't push an event: %s", SDL_GetError());
+  }
+}
+
+// Read some bytes of the recording.
+bool InputReplayer::read(void *bytes, size_t size)
+{
+  if (data.size() - offset < size)
+    return false;
+  memcpy(bytes, data.data() + offset, size);
+  offset += size;
+  return true;
+}
+
+// Read a hint and apply it.
+bool InputReplayer::readHint()
+{
+  string texts[2];
+  for (string &text : texts)
+  {
+    Uint8 bytes[4];
+    if (!read(bytes, sizeof(bytes)))
+      return false;
+    const size_t length = static_cast<size_t>(readLittleEndian(bytes, 4));
+    if (data.size() - offset < length)
+      return false;
+    text.assign(reinterpret_cast<const char *>(data.data() + offset), length);
+    offset += length;
+  }
+  // An empty value was a hint without a value.
+  if (texts[1].empty())
+    theHintsManager.reset(texts[0]);
+  else
+    theHintsManager.setWithPriority(texts[0], texts[1]);
+  return true;
+}
@@ -0,0 +1,25 @@
+/// @file Simd.hpp
+/// @author DP-Dev
+/// @brief Detection of the vector instructions enabled by the compiler.
+///
+/// This header is internal to the library. It includes the intrinsics and
+/// defines CPGE_SIMD_AVX2, CPGE_SIMD_SSE2 or CPGE_SIMD_NEON, so every module
+/// picks its kernels the same way. CPGE_SIMD_SSE2 is defined with
+/// CPGE_SIMD_AVX2 too.
+#ifndef SIMD_HPP
+#define SIMD_HPP true
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define CPGE_SIMD_AVX2 true
+#define CPGE_SIMD_SSE2 true
+#elif defined(__SSE2__) || defined(_M_X64) ||                                 \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CPGE_SIMD_SSE2 true
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define CPGE_SIMD_NEON true
+#endif
+
+#endif
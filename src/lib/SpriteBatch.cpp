@@ -0,0 +1,392 @@
+// File: SpriteBatch.cpp
+// Author: DP-Dev
+// Implementation of the sprite batch classes.
+#include "Simd.hpp"
+#include <CPGE/Log.hpp>
+#include <CPGE/Memory.hpp>
+#include <CPGE/SpriteBatch.hpp>
+#include <algorithm>
+#include <functional>
+using namespace CPGE;
+using namespace std;
+
+namespace
+{
+  // Sort sprites by layer and then by source, keeping the submission order of
+  // equal sprites.
+  template <typename Sprite, typename Source>
+  void sortSprites(vector<Sprite> &sprites, Source Sprite::*source)
+  {
+    stable_sort(sprites.begin(), sprites.end(),
+      [source](const Sprite &a, const Sprite &b)
+      {
+        if (a.layer != b.layer)
+          return a.layer < b.layer;
+        return less<const void *>()(a.*source, b.*source);
+      });
+  }
+
+  // Get the seconds elapsed since a performance counter value.
+  double secondsSince(Uint64 start)
+  {
+    return static_cast<double>(SDL_GetPerformanceCounter() - start) /
+           static_cast<double>(SDL_GetPerformanceFrequency());
+  }
+
+  // Print the statistics of a batch.
+  void printStats(const char *name, const SpriteBatchStats &stats)
+  {
+    // Fill rate in millions of pixels per second.
+    const double fillRate =
+      stats.seconds > 0.0
+        ? static_cast<double>(stats.pixels) / stats.seconds / 1000000.0
+        : 0.0;
+    theLog.printInfo(LogCategory::RENDER,
+      "%s: %lu sprites in %lu batches, %lu pixels in %.3f ms (%.1f Mpx/s)",
+      name, stats.sprites, stats.batches,
+      static_cast<unsigned long>(stats.pixels), stats.seconds * 1000.0,
+      fillRate);
+  }
+
+  // Get the first destination pixel whose centre the sampler maps at or
+  // after a source edge, with a step in 16.16 fixed point, within the size.
+  Sint64 findPixel(Sint64 edge, Sint64 step, int size)
+  {
+    // The pixel d samples the source at d * step + step / 2.
+    const Sint64 position = (edge << 16) - step / 2;
+    if (position <= 0)
+      return 0;
+    return min<Sint64>((position + step - 1) / step, size);
+  }
+
+  // Divide by 255 with rounding, exact for every product of two bytes.
+  inline Uint32 div255(Uint32 value)
+  {
+    value += 128;
+    return (value + (value >> 8)) >> 8;
+  }
+
+  // Modulate and blend an ARGB8888 pixel over another.
+  inline Uint32 blendPixel(Uint32 src, Uint32 dst, const SDL_Color &color)
+  {
+    // Modulate the source.
+    const Uint32 sa = div255((src >> 24) * color.a);
+    const Uint32 sr = div255(((src >> 16) & 0xFF) * color.r);
+    const Uint32 sg = div255(((src >> 8) & 0xFF) * color.g);
+    const Uint32 sb = div255((src & 0xFF) * color.b);
+    // Blend with the destination.
+    const Uint32 ia = 255 - sa;
+    const Uint32 a = div255(sa * 255 + (dst >> 24) * ia);
+    const Uint32 r = div255(sr * sa + ((dst >> 16) & 0xFF) * ia);
+    const Uint32 g = div255(sg * sa + ((dst >> 8) & 0xFF) * ia);
+    const Uint32 b = div255(sb * sa + (dst & 0xFF) * ia);
+    return (a << 24) | (r << 16) | (g << 8) | b;
+  }
+
+#if defined(CPGE_SIMD_SSE2)
+  // Divide eight 16 bits lanes by 255, like div255().
+  inline __m128i div255(__m128i value)
+  {
+    value = _mm_add_epi16(value, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(value, _mm_srli_epi16(value, 8)), 8);
+  }
+
+  // Modulate and blend two pixels unpacked to 16 bits lanes, like
+  // blendPixel().
+  inline __m128i blendUnpacked(__m128i src, __m128i dst, __m128i color)
+  {
+    // Lanes 3 and 7 hold the alpha of each pixel.
+    const __m128i alphaLanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+    src = div255(_mm_mullo_epi16(src, color));
+    // Broadcast the source alpha, the alpha lanes are multiplied by 255.
+    __m128i alpha = _mm_shufflelo_epi16(src, 0xFF);
+    alpha = _mm_shufflehi_epi16(alpha, 0xFF);
+    const __m128i srcFactor =
+      _mm_or_si128(_mm_andnot_si128(alphaLanes, alpha),
+        _mm_and_si128(alphaLanes, _mm_set1_epi16(255)));
+    const __m128i dstFactor = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+    return div255(_mm_add_epi16(
+      _mm_mullo_epi16(src, srcFactor), _mm_mullo_epi16(dst, dstFactor)));
+  }
+
+  // Modulate and blend four ARGB8888 pixels.
+  inline __m128i blendPixels(__m128i src, __m128i dst, __m128i color)
+  {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i low = blendUnpacked(_mm_unpacklo_epi8(src, zero),
+      _mm_unpacklo_epi8(dst, zero), color);
+    const __m128i high = blendUnpacked(_mm_unpackhi_epi8(src, zero),
+      _mm_unpackhi_epi8(dst, zero), color);
+    return _mm_packus_epi16(low, high);
+  }
+#endif
+
+  // Check that a surface can be used by the software path.
+  bool checkFormat(const SDL_Surface *surface)
+  {
+    if (surface->format->format == SDL_PIXELFORMAT_ARGB8888)
+      return true;
+    theLog.printError(LogCategory::RENDER,
+      "SoftwareSpriteBatch: surfaces must use SDL_PIXELFORMAT_ARGB8888");
+    return false;
+  }
+} // namespace
+
+// Submit a sprite.
+void SpriteBatch::draw(SDL_Texture *texture, const SDL_Rect &source,
+  const SDL_FRect &destination, int layer, SDL_Color color)
+{
+  MemoryTagScope scope(MemoryTag::RENDER);
+  sprites.push_back({texture, source, destination, color, layer});
+}
+
+// Draw the submitted sprites.
+bool SpriteBatch::flush(SDL_Renderer *renderer)
+{
+  MemoryTagScope scope(MemoryTag::RENDER);
+  const Uint64 start = SDL_GetPerformanceCounter();
+  bool success = true;
+  stats = SpriteBatchStats();
+  sortSprites(sprites, &Sprite::texture);
+  size_t first = 0;
+  while (first < sprites.size())
+  {
+    // Find the run of sprites that share the layer and the texture.
+    SDL_Texture *texture = sprites[first].texture;
+    size_t last = first + 1;
+    while (last < sprites.size() && sprites[last].texture == texture &&
+           sprites[last].layer == sprites[first].layer)
+      ++last;
+    // The texture size converts the source rectangles to coordinates.
+    int width = 1;
+    int height = 1;
+    if (texture && SDL_QueryTexture(texture, nullptr, nullptr, &width, &height))
+    {
+      theLog.printError(LogCategory::RENDER,
+        "SpriteBatch: can't query a texture: %s", SDL_GetError());
+      success = false;
+      first = last;
+      continue;
+    }
+    const float u = 1.0f / static_cast<float>(width);
+    const float v = 1.0f / static_cast<float>(height);
+    // Build four vertices per sprite.
+    vertices.clear();
+    for (size_t i = first; i < last; ++i)
+    {
+      const Sprite &sprite = sprites[i];
+      const SDL_FRect &dst = sprite.destination;
+      const float u0 = static_cast<float>(sprite.source.x) * u;
+      const float v0 = static_cast<float>(sprite.source.y) * v;
+      const float u1 =
+        static_cast<float>(sprite.source.x + sprite.source.w) * u;
+      const float v1 =
+        static_cast<float>(sprite.source.y + sprite.source.h) * v;
+      vertices.push_back({{dst.x, dst.y}, sprite.color, {u0, v0}});
+      vertices.push_back({{dst.x + dst.w, dst.y}, sprite.color, {u1, v0}});
+      vertices.push_back(
+        {{dst.x + dst.w, dst.y + dst.h}, sprite.color, {u1, v1}});
+      vertices.push_back({{dst.x, dst.y + dst.h}, sprite.color, {u0, v1}});
+      stats.pixels += static_cast<Uint64>(dst.w * dst.h);
+    }
+    // The indices are the same for every batch, grow them when needed.
+    const size_t count = last - first;
+    while (indices.size() < count * 6)
+    {
+      const int base = static_cast<int>(indices.size() / 6 * 4);
+      indices.insert(indices.end(),
+        {base, base + 1, base + 2, base + 2, base + 3, base});
+    }
+    if (SDL_RenderGeometry(renderer, texture, vertices.data(),
+          static_cast<int>(vertices.size()), indices.data(),
+          static_cast<int>(count * 6)))
+    {
+      theLog.printError(LogCategory::RENDER,
+        "SpriteBatch: can't draw a batch: %s", SDL_GetError());
+      success = false;
+    }
+    ++stats.batches;
+    first = last;
+  }
+  stats.sprites = sprites.size();
+  sprites.clear();
+  stats.seconds = secondsSince(start);
+  return success;
+}
+
+// Discard the submitted sprites.
+void SpriteBatch::clear()
+{
+  sprites.clear();
+}
+
+// Get the statistics of the last flush.
+const SpriteBatchStats &SpriteBatch::getStats() const
+{
+  return stats;
+}
+
+// Print the statistics of the last flush.
+void SpriteBatch::logStats() const
+{
+  printStats("SpriteBatch", stats);
+}
+
+// Submit a sprite.
+void SoftwareSpriteBatch::draw(SDL_Surface *surface, const SDL_Rect &source,
+  const SDL_Rect &destination, int layer, SDL_Color color)
+{
+  MemoryTagScope scope(MemoryTag::RENDER);
+  sprites.push_back({surface, source, destination, color, layer});
+}
+
+// Blend the submitted sprites.
+bool SoftwareSpriteBatch::flush(SDL_Surface *target)
+{
+  MemoryTagScope scope(MemoryTag::RENDER);
+  const Uint64 start = SDL_GetPerformanceCounter();
+  stats = SpriteBatchStats();
+  if (!checkFormat(target) || SDL_LockSurface(target))
+  {
+    sprites.clear();
+    return false;
+  }
+  SDL_Rect clip;
+  SDL_GetClipRect(target, &clip);
+  bool success = true;
+  sortSprites(sprites, &Sprite::surface);
+  size_t first = 0;
+  while (first < sprites.size())
+  {
+    // Find the run of sprites that share the layer and the surface.
+    SDL_Surface *surface = sprites[first].surface;
+    size_t last = first + 1;
+    while (last < sprites.size() && sprites[last].surface == surface &&
+           sprites[last].layer == sprites[first].layer)
+      ++last;
+    if (!checkFormat(surface) || SDL_LockSurface(surface))
+    {
+      success = false;
+      first = last;
+      continue;
+    }
+    for (size_t i = first; i < last; ++i)
+      stats.pixels += blend(sprites[i], target, clip);
+    SDL_UnlockSurface(surface);
+    ++stats.batches;
+    first = last;
+  }
+  SDL_UnlockSurface(target);
+  stats.sprites = sprites.size();
+  sprites.clear();
+  stats.seconds = secondsSince(start);
+  return success;
+}
+
+// Discard the submitted sprites.
+void SoftwareSpriteBatch::clear()
+{
+  sprites.clear();
+}
+
+// Get the statistics of the last flush.
+const SpriteBatchStats &SoftwareSpriteBatch::getStats() const
+{
+  return stats;
+}
+
+// Print the statistics of the last flush.
+void SoftwareSpriteBatch::logStats() const
+{
+  printStats("SoftwareSpriteBatch", stats);
+}
+
+// Blend a sprite into the target.
+Uint64 SoftwareSpriteBatch::blend(
+  const Sprite &sprite, SDL_Surface *target, const SDL_Rect &clip)
+{
+  // Keep the source inside the surface.
+  const SDL_Surface *surface = sprite.surface;
+  const SDL_Rect bounds = {0, 0, surface->w, surface->h};
+  const SDL_Rect &full = sprite.source;
+  const SDL_Rect &destination = sprite.destination;
+  SDL_Rect source;
+  if (destination.w <= 0 || destination.h <= 0 ||
+      !SDL_IntersectRect(&full, &bounds, &source))
+    return 0;
+  // Steps in the source per destination pixel, in 16.16 fixed point.
+  const Sint64 stepX = (static_cast<Sint64>(full.w) << 16) / destination.w;
+  const Sint64 stepY = (static_cast<Sint64>(full.h) << 16) / destination.h;
+  if (!stepX || !stepY)
+    return 0;
+  // Crop the destination to the pixels whose centres sample the clipped
+  // source, then keep it inside the clip.
+  const Sint64 left = source.x - full.x;
+  const Sint64 top = source.y - full.y;
+  SDL_Rect cropped;
+  cropped.x = static_cast<int>(findPixel(left, stepX, destination.w));
+  cropped.y = static_cast<int>(findPixel(top, stepY, destination.h));
+  cropped.w = static_cast<int>(
+                findPixel(left + source.w, stepX, destination.w)) -
+              cropped.x;
+  cropped.h = static_cast<int>(
+                findPixel(top + source.h, stepY, destination.h)) -
+              cropped.y;
+  cropped.x += destination.x;
+  cropped.y += destination.y;
+  SDL_Rect area;
+  if (!SDL_IntersectRect(&cropped, &clip, &area))
+    return 0;
+  // The positions of the centre of the first pixel of the area from the
+  // clipped source.
+  const Uint64 startX = static_cast<Uint64>(
+    (area.x - destination.x) * stepX + stepX / 2 - (left << 16));
+  const Uint64 startY = static_cast<Uint64>(
+    (area.y - destination.y) * stepY + stepY / 2 - (top << 16));
+#if defined(CPGE_SIMD_SSE2)
+  const SDL_Color &c = sprite.color;
+  const __m128i color =
+    _mm_set_epi16(c.a, c.r, c.g, c.b, c.a, c.r, c.g, c.b);
+#endif
+  for (int y = 0; y < area.h; ++y)
+  {
+    // Get the rows to read and write.
+    const int sourceY = source.y + static_cast<int>((startY + y * stepY) >> 16);
+    const Uint32 *src = reinterpret_cast<const Uint32 *>(
+                          static_cast<const Uint8 *>(surface->pixels) +
+                          sourceY * surface->pitch) +
+                        source.x;
+    Uint32 *dst =
+      reinterpret_cast<Uint32 *>(
+        static_cast<Uint8 *>(target->pixels) + (area.y + y) * target->pitch) +
+      area.x;
+    int x = 0;
+#if defined(CPGE_SIMD_SSE2)
+    // Blend four pixels at a time, gathering them when the sprite is scaled.
+    for (; x + 4 <= area.w; x += 4)
+    {
+      __m128i pixels;
+      if (stepX == 0x10000)
+        pixels = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(src + ((startX >> 16) + x)));
+      else
+      {
+        const Uint64 position = startX + x * stepX;
+        pixels =
+          _mm_set_epi32(static_cast<int>(src[(position + 3 * stepX) >> 16]),
+            static_cast<int>(src[(position + 2 * stepX) >> 16]),
+            static_cast<int>(src[(position + stepX) >> 16]),
+            static_cast<int>(src[position >> 16]));
+      }
+      __m128i *out = reinterpret_cast<__m128i *>(dst + x);
+      _mm_storeu_si128(out,
+        blendPixels(pixels, _mm_loadu_si128(out), color));
+    }
+#endif
+    // Blend the remaining pixels.
+    for (; x < area.w; ++x)
+      dst[x] =
+        blendPixel(src[(startX + x * stepX) >> 16], dst[x], sprite.color);
+  }
+  return static_cast<Uint64>(area.w) * static_cast<Uint64>(area.h);
+}
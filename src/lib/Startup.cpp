@@ -0,0 +1,321 @@
+// File: Startup.cpp
+// Author: DP-Dev
+// Implementation of the class StartupManager.
+#include <CPGE/Hints.hpp>
+#include <CPGE/Log.hpp>
+#include <CPGE/Memory.hpp>
+#include <CPGE/Metrics.hpp>
+#include <CPGE/Startup.hpp>
+#include <algorithm>
+using namespace CPGE;
+using namespace std;
+
+// Set the reference to the unique instance of the class.
+StartupManager &CPGE::theStartupManager = StartupManager::getInstace();
+
+namespace
+{
+  // The subsystems that some platforms only allow in the main thread.
+  const Uint32 MAIN_THREAD_SUBSYSTEMS = SDL_INIT_VIDEO | SDL_INIT_EVENTS;
+
+  // The SDL subsystems and their names.
+  const struct
+  {
+    Uint32 flag;
+    const char *name;
+  } SUBSYSTEMS[] = {{SDL_INIT_TIMER, "TIMER"}, {SDL_INIT_AUDIO, "AUDIO"},
+    {SDL_INIT_VIDEO, "VIDEO"}, {SDL_INIT_JOYSTICK, "JOYSTICK"},
+    {SDL_INIT_HAPTIC, "HAPTIC"}, {SDL_INIT_GAMECONTROLLER, "GAMECONTROLLER"},
+    {SDL_INIT_EVENTS, "EVENTS"}, {SDL_INIT_SENSOR, "SENSOR"}};
+
+  // Get the names of a set of subsystems.
+  string getSubsystemNames(Uint32 subsystems)
+  {
+    string names = "SDL";
+    for (const auto &subsystem : SUBSYSTEMS)
+      if (subsystems & subsystem.flag)
+        names += string(" ") + subsystem.name;
+    return names;
+  }
+} // namespace
+
+// Wait for the background threads.
+StartupManager::~StartupManager()
+{
+  waitForBackground();
+}
+
+// Register a service.
+bool StartupManager::addService(const string &name, InitFunction init,
+  const vector<string> &dependencies, Uint32 subsystems, QuitFunction quit)
+{
+  {
+    lock_guard<std::mutex> lock(guard);
+    if (!services.count(name))
+    {
+      Service &service = services[name];
+      service.init = init;
+      service.quit = quit;
+      service.dependencies = dependencies;
+      service.subsystems = subsystems;
+      service.state = State::PENDING;
+      return true;
+    }
+  }
+  theLog.printError(LogCategory::SYSTEM,
+    "StartupManager: the service %s already exists", name.c_str());
+  return false;
+}
+
+// Initialize a service and its dependencies.
+bool StartupManager::require(const string &name)
+{
+  unique_lock<std::mutex> lock(guard);
+  const auto found = services.find(name);
+  if (found == services.end())
+  {
+    lock.unlock();
+    theLog.printError(LogCategory::SYSTEM,
+      "StartupManager: the service %s doesn't exist", name.c_str());
+    return false;
+  }
+  // The references to the elements of a map stay valid.
+  Service &service = found->second;
+  while (service.state == State::RUNNING)
+  {
+    if (closesCycle(service))
+    {
+      lock.unlock();
+      theLog.printError(LogCategory::SYSTEM,
+        "StartupManager: the service %s is in a dependency cycle",
+        name.c_str());
+      return false;
+    }
+    waiting[this_thread::get_id()] = name;
+    finished.wait(lock);
+    waiting.erase(this_thread::get_id());
+  }
+  if (service.state != State::PENDING)
+    return service.state == State::READY;
+  // Leave the services that need the main thread for it.
+  if (this_thread::get_id() != mainThread &&
+      (service.subsystems & MAIN_THREAD_SUBSYSTEMS &
+        ~SDL_WasInit(MAIN_THREAD_SUBSYSTEMS)))
+    return false;
+  service.state = State::RUNNING;
+  service.owner = this_thread::get_id();
+  const vector<string> dependencies = service.dependencies;
+  const InitFunction init = service.init;
+  const Uint32 subsystems = service.subsystems;
+  lock.unlock();
+  bool success = true;
+  for (const string &dependency : dependencies)
+  {
+    if (require(dependency))
+      continue;
+    // A dependency left for the main thread leaves this service too.
+    lock.lock();
+    const auto other = services.find(dependency);
+    const bool deferred =
+      other != services.end() && other->second.state == State::PENDING;
+    if (deferred)
+      service.state = State::PENDING;
+    lock.unlock();
+    if (deferred)
+    {
+      finished.notify_all();
+      return false;
+    }
+    success = false;
+    break;
+  }
+  if (success)
+    success = requireSubsystems(subsystems);
+  const double start = now();
+  if (success && init)
+    success = init();
+  record(name, start, success);
+  lock.lock();
+  service.state = success ? State::READY : State::FAILED;
+  if (success)
+    initialized.push_back(name);
+  lock.unlock();
+  finished.notify_all();
+  if (!success)
+    theLog.printError(LogCategory::SYSTEM,
+      "StartupManager: can't initialize the service %s", name.c_str());
+  return success;
+}
+
+// Initialize SDL subsystems.
+bool StartupManager::requireSubsystems(Uint32 subsystems)
+{
+  lock_guard<std::mutex> lock(subsystemGuard);
+  const Uint32 missing = subsystems & ~SDL_WasInit(subsystems);
+  if (!missing)
+    return true;
+  const double start = now();
+  const bool success = !SDL_InitSubSystem(missing);
+  record(getSubsystemNames(missing), start, success);
+  if (!success)
+  {
+    theLog.printError(LogCategory::SYSTEM,
+      "StartupManager: can't initialize %s: %s",
+      getSubsystemNames(missing).c_str(), SDL_GetError());
+    return false;
+  }
+  this->subsystems |= missing;
+  return true;
+}
+
+// Initialize services in a background thread.
+void StartupManager::startInBackground(const vector<string> &names)
+{
+  lock_guard<std::mutex> lock(guard);
+  threads.emplace_back([this, names]() {
+    for (const string &name : names)
+      require(name);
+  });
+}
+
+// Wait for the background threads.
+void StartupManager::waitForBackground()
+{
+  vector<std::thread> threads;
+  {
+    lock_guard<std::mutex> lock(guard);
+    threads.swap(this->threads);
+  }
+  for (std::thread &thread : threads)
+    thread.join();
+}
+
+// Record the time of the first frame.
+void StartupManager::markFirstFrame()
+{
+  {
+    lock_guard<std::mutex> lock(guard);
+    if (firstFrame)
+      return;
+    firstFrame = true;
+  }
+  record("first frame", now(), true);
+}
+
+// Get the startup timeline.
+vector<StartupEvent> StartupManager::getTimeline()
+{
+  lock_guard<std::mutex> lock(guard);
+  return timeline;
+}
+
+// Print the startup timeline.
+void StartupManager::logTimeline()
+{
+  vector<StartupEvent> timeline = getTimeline();
+  stable_sort(timeline.begin(), timeline.end(),
+    [](const StartupEvent &a, const StartupEvent &b) {
+      return a.start < b.start;
+    });
+  for (const StartupEvent &event : timeline)
+    theLog.printInfo(LogCategory::SYSTEM,
+      "Startup: %9.3f ms %9.3f ms %s%s%s", event.start * 1000.0,
+      event.duration * 1000.0, event.name.c_str(),
+      event.background ? " (background)" : "",
+      event.success ? "" : " (failed)");
+}
+
+// Shut down the services and the subsystems.
+void StartupManager::shutdown()
+{
+  waitForBackground();
+  vector<QuitFunction> quits;
+  {
+    lock_guard<std::mutex> lock(guard);
+    for (auto name = initialized.rbegin(); name != initialized.rend(); ++name)
+    {
+      Service &service = services[*name];
+      service.state = State::PENDING;
+      if (service.quit)
+        quits.push_back(service.quit);
+    }
+    initialized.clear();
+  }
+  for (const QuitFunction &quit : quits)
+    quit();
+  lock_guard<std::mutex> lock(subsystemGuard);
+  if (subsystems)
+    SDL_QuitSubSystem(subsystems);
+  subsystems = 0;
+}
+
+// Get the unique instance of the class.
+StartupManager &StartupManager::getInstace()
+{
+  static StartupManager theStartupManager;
+  return theStartupManager;
+}
+
+// Start the timeline and register the engine services.
+StartupManager::StartupManager()
+  : origin(chrono::steady_clock::now()), mainThread(this_thread::get_id())
+{
+  // This runs in the static initialization, the services only reach the
+  // other singletons and SDL when they are required.
+  addService(STARTUP_MEMORY_HOOK, []() { return theMemoryTracker.hookSDL(); });
+  addService(
+    STARTUP_LOG_FILE,
+    [this]() {
+      const string path = theHintsManager.get(CPGE_HINT_LOG_FILE);
+      return path.empty() || logFile.open(path);
+    },
+    {}, 0, [this]() { logFile.close(); });
+  addService(
+    STARTUP_METRICS,
+    []() {
+      theMetricsRegistry.startSnapshots();
+      return true;
+    },
+    {STARTUP_LOG_FILE}, 0, []() { theMetricsRegistry.stopSnapshots(); });
+}
+
+// Check whether waiting for a service closes a cycle of waiting threads.
+bool StartupManager::closesCycle(const Service &service) const
+{
+  // Follow the owner of the service to the service it waits for, and so on.
+  // A chain without cycles is never longer than the number of services.
+  const Service *next = &service;
+  for (size_t i = 0; i <= services.size(); ++i)
+  {
+    // A thread woken up but still waiting for the lock isn't blocked.
+    if (next->state != State::RUNNING)
+      return false;
+    if (next->owner == this_thread::get_id())
+      return true;
+    const auto wait = waiting.find(next->owner);
+    if (wait == waiting.end())
+      return false;
+    next = &services.find(wait->second)->second;
+  }
+  return false;
+}
+
+// Get the seconds elapsed since the manager was created.
+double StartupManager::now() const
+{
+  return chrono::duration<double>(chrono::steady_clock::now() - origin)
+    .count();
+}
+
+// Add an entry to the timeline.
+void StartupManager::record(const string &name, double start, bool success)
+{
+  StartupEvent event;
+  event.name = name;
+  event.start = start;
+  event.duration = now() - start;
+  event.success = success;
+  event.background = this_thread::get_id() != mainThread;
+  lock_guard<std::mutex> lock(guard);
+  timeline.push_back(event);
+}
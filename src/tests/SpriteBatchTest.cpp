@@ -0,0 +1,114 @@
+// File: SpriteBatchTest.cpp
+// Author: DP-Dev
+// Check that SoftwareSpriteBatch draws every destination pixel whose centre
+// samples the visible part of a clipped, scaled sprite, and nothing else.
+#include <CPGE/SpriteBatch.hpp>
+#include <cstdio>
+using namespace CPGE;
+using namespace std;
+
+namespace
+{
+  // The size of the target surface.
+  const int TARGET_SIZE = 24;
+
+  // Get the source pixel sampled by the centre of a destination pixel, from
+  // the start of the source region, with the 16.16 fixed point step of the
+  // batch.
+  int getSourcePixel(int pixel, int sourceSize, int destinationSize)
+  {
+    const Sint64 step =
+      (static_cast<Sint64>(sourceSize) << 16) / destinationSize;
+    return static_cast<int>((pixel * step + step / 2) >> 16);
+  }
+
+  // Draw a sprite of a surface filled with distinct opaque pixels and compare
+  // every pixel of the target with the pixel that its centre samples.
+  bool check(const char *name, int width, int height, const SDL_Rect &source,
+    const SDL_Rect &destination, const SDL_Rect &clip)
+  {
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(
+      0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Surface *target = SDL_CreateRGBSurfaceWithFormat(
+      0, TARGET_SIZE, TARGET_SIZE, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (!surface || !target)
+    {
+      fprintf(stderr, "%s: can't create the surfaces: %s\n", name,
+        SDL_GetError());
+      SDL_FreeSurface(surface);
+      SDL_FreeSurface(target);
+      return false;
+    }
+    for (int y = 0; y < height; ++y)
+      for (int x = 0; x < width; ++x)
+        reinterpret_cast<Uint32 *>(static_cast<Uint8 *>(surface->pixels) +
+                                   y * surface->pitch)[x] =
+          0xFF000000u | static_cast<Uint32>(y << 8 | x);
+    for (int y = 0; y < TARGET_SIZE; ++y)
+      for (int x = 0; x < TARGET_SIZE; ++x)
+        reinterpret_cast<Uint32 *>(static_cast<Uint8 *>(target->pixels) +
+                                   y * target->pitch)[x] = 0;
+    SDL_SetClipRect(target, &clip);
+    SoftwareSpriteBatch batch;
+    batch.draw(surface, source, destination);
+    bool success = batch.flush(target);
+    Uint64 expectedPixels = 0;
+    for (int y = 0; y < TARGET_SIZE && success; ++y)
+      for (int x = 0; x < TARGET_SIZE && success; ++x)
+      {
+        Uint32 expected = 0;
+        const SDL_Point point = {x, y};
+        if (SDL_PointInRect(&point, &clip) &&
+            SDL_PointInRect(&point, &destination))
+        {
+          const int sourceX = source.x + getSourcePixel(x - destination.x,
+                                           source.w, destination.w);
+          const int sourceY = source.y + getSourcePixel(y - destination.y,
+                                           source.h, destination.h);
+          if (sourceX >= 0 && sourceX < width && sourceY >= 0 &&
+              sourceY < height)
+          {
+            expected = 0xFF000000u | static_cast<Uint32>(sourceY << 8 |
+                                                         sourceX);
+            ++expectedPixels;
+          }
+        }
+        const Uint32 pixel = reinterpret_cast<const Uint32 *>(
+          static_cast<const Uint8 *>(target->pixels) + y * target->pitch)[x];
+        if (pixel != expected)
+        {
+          fprintf(stderr, "%s: pixel %d, %d is %08x instead of %08x\n", name,
+            x, y, pixel, expected);
+          success = false;
+        }
+      }
+    if (success && batch.getStats().pixels != expectedPixels)
+    {
+      fprintf(stderr, "%s: %lu pixels drawn instead of %lu\n", name,
+        static_cast<unsigned long>(batch.getStats().pixels),
+        static_cast<unsigned long>(expectedPixels));
+      success = false;
+    }
+    SDL_FreeSurface(surface);
+    SDL_FreeSurface(target);
+    return success;
+  }
+} // namespace
+
+// Run the checks.
+int main()
+{
+  const SDL_Rect whole = {0, 0, TARGET_SIZE, TARGET_SIZE};
+  bool success = true;
+  // Only the rows 9 to 13 of the source exist, one destination row samples
+  // them.
+  success &= check("scaled down, clipped by the surface", 4, 5,
+    {0, -9, 4, 60}, {2, 3, 4, 17}, whole);
+  success &= check("scaled up, clipped by the surface", 5, 4,
+    {-3, -2, 9, 7}, {-1, 1, 20, 16}, whole);
+  success &= check("scaled, clipped by the surface and the target", 7, 6,
+    {-2, 1, 11, 8}, {-5, -3, 25, 19}, {3, 2, 13, 15});
+  success &= check("scaled down wide, clipped on every side", 9, 9,
+    {-4, -4, 17, 17}, {1, 1, 13, 7}, {2, 0, 9, 5});
+  return success ? 0 : 1;
+}
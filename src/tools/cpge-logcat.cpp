@@ -0,0 +1,37 @@
+// File: cpge-logcat.cpp
+// Author: DP-Dev
+// Print the messages of the log files written by LogFileSink.
+#include <CPGE/LogFile.hpp>
+#include <cstdio>
+using namespace CPGE;
+using namespace std;
+
+// Print every file given.
+int main(int argc, char **argv)
+{
+  if (argc < 2)
+  {
+    fprintf(stderr, "Usage: %s FILE...\n", argv[0]);
+    return 2;
+  }
+  int status = 0;
+  LogFileReader reader;
+  vector<LogRecord> records;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (!reader.open(argv[i]))
+    {
+      fprintf(stderr, "%s: %s isn't a CPGE log file\n", argv[0], argv[i]);
+      status = 1;
+      continue;
+    }
+    while (reader.readBlock(records))
+      for (const LogRecord &record : records)
+        printf("%s\n", formatLogRecord(record).c_str());
+    // A file cut by a crash is printed up to its last complete block.
+    if (reader.isTruncated())
+      fprintf(stderr, "%s: %s ends with an incomplete block\n", argv[0],
+        argv[i]);
+  }
+  return status;
+}
@@ -0,0 +1,175 @@
+// File: cpge-logquery.cpp
+// Author: DP-Dev
+// Print the messages of a log file that match a time range, categories and
+// a priority, reading only the blocks that can hold them.
+#include <CPGE/LogFile.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+using namespace CPGE;
+using namespace std;
+
+namespace
+{
+  // The messages to print.
+  struct Query
+  {
+    // The oldest time, in milliseconds.
+    Uint64 from = 0;
+    // The newest time, in milliseconds.
+    Uint64 to = ~static_cast<Uint64>(0);
+    // The categories, empty for every category.
+    vector<int> categories;
+    // The categories as a mask, to skip blocks. The custom categories share
+    // a bit, so the records are compared with the list.
+    Uint32 categoryMask = ~static_cast<Uint32>(0);
+    // The priorities, as a mask.
+    Uint32 priorities = ~static_cast<Uint32>(0);
+  };
+
+  // Print the usage.
+  int printUsage(const char *program)
+  {
+    fprintf(stderr,
+      "Usage: %s [--from SECONDS] [--to SECONDS] [--category NAME[,NAME...]]"
+      " [--priority NAME] FILE\n"
+      "Print the messages between two times, of some categories, with a\n"
+      "priority or a higher one. Categories are names like RENDER or\n"
+      "numbers, priorities are VERBOSE, DEBUG, INFO, WARN, ERROR or\n"
+      "CRITICAL.\n",
+      program);
+    return 2;
+  }
+
+  // Parse a time in seconds.
+  bool parseTime(const char *text, Uint64 &ticks)
+  {
+    char *end;
+    const double seconds = strtod(text, &end);
+    if (end == text || *end || seconds < 0.0)
+      return false;
+    ticks = static_cast<Uint64>(seconds * 1000.0 + 0.5);
+    return true;
+  }
+
+  // Parse a list of categories separated by commas.
+  bool parseCategories(const char *text, Query &query)
+  {
+    query.categories.clear();
+    query.categoryMask = 0;
+    const string list = text;
+    size_t start = 0;
+    while (start <= list.size())
+    {
+      size_t end = list.find(',', start);
+      end = end == string::npos ? list.size() : end;
+      const string name = list.substr(start, end - start);
+      int category = -1;
+      for (int i = 0; getLogCategoryName(static_cast<LogCategory>(i)); ++i)
+        if (name == getLogCategoryName(static_cast<LogCategory>(i)))
+          category = i;
+      // The custom categories go by number.
+      if (category < 0)
+      {
+        char *last;
+        const long number = strtol(name.c_str(), &last, 10);
+        if (name.empty() || *last || number < 0)
+          return false;
+        category = static_cast<int>(number);
+      }
+      query.categories.push_back(category);
+      query.categoryMask |= LogBlockSummary::getCategoryBit(category);
+      start = end + 1;
+    }
+    return true;
+  }
+
+  // Parse a priority, the mask holds it and the higher ones.
+  bool parsePriority(const char *text, Uint32 &priorities)
+  {
+    priorities = 0;
+    for (int i = static_cast<int>(LogPriority::CRITICAL); i > 0; --i)
+    {
+      priorities |= LogBlockSummary::getPriorityBit(i);
+      if (!strcmp(text, getLogPriorityName(static_cast<LogPriority>(i))))
+        return true;
+    }
+    return false;
+  }
+} // namespace
+
+// Print the messages that match the options.
+int main(int argc, char **argv)
+{
+  Query query;
+  const char *path = nullptr;
+  for (int i = 1; i < argc; ++i)
+  {
+    const bool hasValue = i + 1 < argc;
+    if (!strcmp(argv[i], "--from") && hasValue)
+    {
+      if (!parseTime(argv[++i], query.from))
+        return printUsage(argv[0]);
+    }
+    else if (!strcmp(argv[i], "--to") && hasValue)
+    {
+      if (!parseTime(argv[++i], query.to))
+        return printUsage(argv[0]);
+    }
+    else if (!strcmp(argv[i], "--category") && hasValue)
+    {
+      if (!parseCategories(argv[++i], query))
+        return printUsage(argv[0]);
+    }
+    else if (!strcmp(argv[i], "--priority") && hasValue)
+    {
+      if (!parsePriority(argv[++i], query.priorities))
+        return printUsage(argv[0]);
+    }
+    else if (argv[i][0] != '-' && !path)
+      path = argv[i];
+    else
+      return printUsage(argv[0]);
+  }
+  if (!path)
+    return printUsage(argv[0]);
+  LogFileReader reader;
+  if (!reader.open(path))
+  {
+    fprintf(stderr, "%s: %s isn't a CPGE log file\n", argv[0], path);
+    return 1;
+  }
+  vector<LogBlockInfo> blocks;
+  reader.getBlocks(blocks);
+  // Only the blocks whose summary matches are read and decompressed.
+  size_t read = 0;
+  vector<LogRecord> records;
+  for (const LogBlockInfo &block : blocks)
+  {
+    if (!block.summary.matches(
+          query.from, query.to, query.categoryMask, query.priorities))
+      continue;
+    ++read;
+    if (!reader.seekBlock(block) || !reader.readBlock(records))
+    {
+      fprintf(stderr, "%s: %s has a damaged block\n", argv[0], path);
+      continue;
+    }
+    for (const LogRecord &record : records)
+    {
+      const int category = static_cast<int>(record.category);
+      const int priority = static_cast<int>(record.priority);
+      if (record.ticks >= query.from && record.ticks <= query.to &&
+          (query.categories.empty() ||
+            find(query.categories.begin(), query.categories.end(),
+              category) != query.categories.end()) &&
+          (LogBlockSummary::getPriorityBit(priority) & query.priorities))
+        printf("%s\n", formatLogRecord(record).c_str());
+    }
+  }
+  fprintf(stderr, "%s: read %lu of %lu blocks, found with the %s\n", argv[0],
+    static_cast<unsigned long>(read), static_cast<unsigned long>(blocks.size()),
+    reader.isIndexed() ? "index" : "block headers");
+  return 0;
+}
@@ -0,0 +1,200 @@
+// File: cpge-mathbench.cpp
+// Author: DP-Dev
+// Time the batch functions of Math against loops of the operators on single
+// values, to see what the instruction set of the build gains.
+#include <CPGE/Math.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+using namespace CPGE;
+using namespace std;
+
+namespace
+{
+  // The number of elements of the arrays, small enough to stay in the cache.
+  const size_t DEFAULT_COUNT = 4096;
+  // The number of times each array is processed.
+  const unsigned DEFAULT_PASSES = 2000;
+
+  // The arrays that the functions read and write.
+  struct Data
+  {
+    // The matrices.
+    vector<Mat4> matrices;
+    // The vectors.
+    vector<Vec4> vectors;
+    // The points.
+    vector<Vec3> points;
+    // The results of the matrices.
+    vector<Mat4> matrixResults;
+    // The results of the vectors.
+    vector<Vec4> vectorResults;
+    // The results of the points.
+    vector<Vec3> pointResults;
+  };
+
+  // Get a pseudo random value between -1 and 1.
+  float getRandom(unsigned &seed)
+  {
+    seed = seed * 1664525u + 1013904223u;
+    return static_cast<float>(seed >> 8) / 8388608.0f - 1.0f;
+  }
+
+  // Fill the arrays with pseudo random values.
+  void fill(Data &data, size_t count)
+  {
+    unsigned seed = 1;
+    data.matrices.resize(count);
+    data.vectors.resize(count);
+    data.points.resize(count);
+    data.matrixResults.resize(count);
+    data.vectorResults.resize(count);
+    data.pointResults.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+      const Quat q = normalize(Quat(getRandom(seed), getRandom(seed),
+        getRandom(seed), getRandom(seed) + 2.0f));
+      data.matrices[i] = toMat4(q);
+      data.matrices[i].col[3] =
+        Vec4(getRandom(seed), getRandom(seed), getRandom(seed), 1.0f);
+      data.vectors[i] =
+        Vec4(getRandom(seed), getRandom(seed), getRandom(seed), 1.0f);
+      data.points[i] = Vec3(getRandom(seed), getRandom(seed), getRandom(seed));
+    }
+  }
+
+  // Get the nanoseconds per element of a function.
+  template <typename Function>
+  double measure(Function function, size_t count, unsigned passes)
+  {
+    // One pass to warm the cache before timing.
+    function();
+    const auto start = chrono::steady_clock::now();
+    for (unsigned i = 0; i < passes; ++i)
+      function();
+    const chrono::duration<double, nano> elapsed =
+      chrono::steady_clock::now() - start;
+    return elapsed.count() / (static_cast<double>(count) * passes);
+  }
+
+  // Print the times of the scalar loop and of the batch function.
+  void printRow(const char *name, double scalar, double batch)
+  {
+    printf("%-20s %10.3f %10.3f %9.2fx\n", name, scalar, batch,
+      batch > 0.0 ? scalar / batch : 0.0);
+  }
+
+  // Print the usage.
+  int printUsage(const char *program)
+  {
+    fprintf(stderr,
+      "Usage: %s [--count ELEMENTS] [--passes PASSES]\n"
+      "Time the batch functions of Math against loops of the operators on\n"
+      "single values, in nanoseconds per element.\n",
+      program);
+    return 2;
+  }
+
+  // Parse a positive number.
+  bool parseNumber(const char *text, unsigned long &number)
+  {
+    char *end;
+    number = strtoul(text, &end, 10);
+    return end != text && !*end && number > 0;
+  }
+} // namespace
+
+// Time the functions and print a table.
+int main(int argc, char **argv)
+{
+  unsigned long count = DEFAULT_COUNT;
+  unsigned long passes = DEFAULT_PASSES;
+  for (int i = 1; i < argc; ++i)
+  {
+    const bool hasValue = i + 1 < argc;
+    if (!strcmp(argv[i], "--count") && hasValue)
+    {
+      if (!parseNumber(argv[++i], count))
+        return printUsage(argv[0]);
+    }
+    else if (!strcmp(argv[i], "--passes") && hasValue)
+    {
+      if (!parseNumber(argv[++i], passes))
+        return printUsage(argv[0]);
+    }
+    else
+      return printUsage(argv[0]);
+  }
+  Data data;
+  fill(data, count);
+  const Mat4 &m = data.matrices[0];
+  const Quat q = normalize(Quat(0.2f, -0.4f, 0.1f, 0.9f));
+  const unsigned n = static_cast<unsigned>(passes);
+  printf("Instruction set: %s, %lu elements, %lu passes\n",
+    mathInstructionSet(), count, passes);
+  printf("%-20s %10s %10s %10s\n", "Function", "Scalar ns", "Batch ns",
+    "Speedup");
+  // The scalar loops use the constexpr operators, the batch functions the
+  // kernels of the instruction set.
+  printRow("transform",
+    measure(
+      [&]() {
+        for (size_t i = 0; i < count; ++i)
+          data.vectorResults[i] = m * data.vectors[i];
+      },
+      count, n),
+    measure(
+      [&]() {
+        transform(m, data.vectors.data(), data.vectorResults.data(), count);
+      },
+      count, n));
+  printRow("transformPoints",
+    measure(
+      [&]() {
+        for (size_t i = 0; i < count; ++i)
+        {
+          const Vec4 v = m * Vec4(data.points[i], 1.0f);
+          data.pointResults[i] = Vec3(v.x, v.y, v.z);
+        }
+      },
+      count, n),
+    measure(
+      [&]() {
+        transformPoints(
+          m, data.points.data(), data.pointResults.data(), count);
+      },
+      count, n));
+  printRow("rotate",
+    measure(
+      [&]() {
+        for (size_t i = 0; i < count; ++i)
+          data.pointResults[i] = rotate(q, data.points[i]);
+      },
+      count, n),
+    measure(
+      [&]() {
+        rotate(q, data.points.data(), data.pointResults.data(), count);
+      },
+      count, n));
+  printRow("multiply",
+    measure(
+      [&]() {
+        for (size_t i = 0; i < count; ++i)
+          data.matrixResults[i] = m * data.matrices[i];
+      },
+      count, n),
+    measure(
+      [&]() {
+        multiply(
+          m, data.matrices.data(), data.matrixResults.data(), count);
+      },
+      count, n));
+  // Keep the results alive, so the loops aren't optimized away.
+  float sum = 0.0f;
+  for (size_t i = 0; i < count; ++i)
+    sum += data.vectorResults[i].x + data.pointResults[i].y +
+           data.matrixResults[i].col[3].z;
+  return sum == sum ? 0 : 1;
+}
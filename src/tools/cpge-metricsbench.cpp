@@ -0,0 +1,114 @@
+// File: cpge-metricsbench.cpp
+// Author: DP-Dev
+// Time the updates of the metrics from several threads at once, to see what
+// recording a value costs the code that is measured.
+#include <CPGE/Metrics.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <thread>
+#include <vector>
+using namespace CPGE;
+using namespace std;
+
+namespace
+{
+  // The number of updates per thread.
+  const unsigned DEFAULT_COUNT = 10000000;
+  // The highest number of threads, twice the shards so some share them.
+  const unsigned DEFAULT_THREADS = METRICS_SHARDS * 2;
+
+  // Get the processor nanoseconds per update of a function run by threads
+  // at once, so the threads waiting for a core don't count.
+  template <typename Function>
+  double measure(Function function, unsigned count, unsigned threads)
+  {
+    vector<std::thread> workers;
+    const clock_t start = clock();
+    for (unsigned t = 0; t < threads; ++t)
+      workers.emplace_back(
+        [&]()
+        {
+          for (unsigned i = 0; i < count; ++i)
+            function(i);
+        });
+    for (std::thread &worker : workers)
+      worker.join();
+    const double seconds =
+      static_cast<double>(clock() - start) / CLOCKS_PER_SEC;
+    return seconds / (static_cast<double>(count) * threads) * 1000000000.0;
+  }
+
+  // Print the usage.
+  int printUsage(const char *program)
+  {
+    fprintf(stderr,
+      "Usage: %s [--count UPDATES] [--threads THREADS]\n"
+      "Time the updates of Counter, Histogram and Gauge from 1 up to THREADS\n"
+      "threads at once, in processor nanoseconds per update.\n",
+      program);
+    return 2;
+  }
+
+  // Parse a positive number.
+  bool parseNumber(const char *text, unsigned long &number)
+  {
+    char *end;
+    number = strtoul(text, &end, 10);
+    return end != text && !*end && number > 0;
+  }
+} // namespace
+
+// Time the updates and print a table.
+int main(int argc, char **argv)
+{
+  unsigned long count = DEFAULT_COUNT;
+  unsigned long threads = DEFAULT_THREADS;
+  for (int i = 1; i < argc; ++i)
+  {
+    const bool hasValue = i + 1 < argc;
+    if (!strcmp(argv[i], "--count") && hasValue)
+    {
+      if (!parseNumber(argv[++i], count))
+        return printUsage(argv[0]);
+    }
+    else if (!strcmp(argv[i], "--threads") && hasValue)
+    {
+      if (!parseNumber(argv[++i], threads))
+        return printUsage(argv[0]);
+    }
+    else
+      return printUsage(argv[0]);
+  }
+  printf("%u shards, %lu updates per thread, %u cores\n", METRICS_SHARDS,
+    count, std::thread::hardware_concurrency());
+  printf("%-8s %10s %10s %10s\n", "Threads", "Counter", "Histogram",
+    "Gauge");
+  const unsigned n = static_cast<unsigned>(count);
+  for (unsigned t = 1; t <= threads; t *= 2)
+  {
+    // New metrics for every row, the registry would keep them all.
+    unique_ptr<Counter> counter(new Counter());
+    unique_ptr<Histogram> histogram(new Histogram());
+    unique_ptr<Gauge> gauge(new Gauge());
+    // The values spread over a few hundred buckets like frame times would.
+    printf("%-8u %10.3f %10.3f %10.3f\n", t,
+      measure([&](unsigned) { counter->add(); }, n, t),
+      measure(
+        [&](unsigned i) { histogram->record((i * 2654435761u) >> 12); }, n,
+        t),
+      measure([&](unsigned) { gauge->add(1); }, n, t));
+    // Check that no update was lost.
+    if (counter->get() != static_cast<Uint64>(n) * t ||
+        histogram->getSnapshot().count != static_cast<Uint64>(n) * t ||
+        gauge->get() != static_cast<Sint64>(n) * t)
+    {
+      fprintf(stderr, "%s: updates were lost with %u threads\n", argv[0], t);
+      return 1;
+    }
+    if (t < threads && t * 2 > threads)
+      t = static_cast<unsigned>(threads) / 2;
+  }
+  return 0;
+}